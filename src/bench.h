@@ -0,0 +1,1089 @@
+#ifndef GUARD_INCLUDE_BENCH_H
+#define GUARD_INCLUDE_BENCH_H
+
+#ifdef BENCH_STATIC
+    #define BENCH_DEF static
+#else
+    #define BENCH_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier.h"
+#include "bezier_batch.h"
+#include "bezier_instanced.h"
+#include "point_grid.h"
+#include "bezier_query.h"
+#include "bezier_intersect.h"
+#include "stroke.h"
+#include "bezier_length.h"
+#include "bezier_path.h"
+
+enum class BenchMode : i32 {
+    Off       = 0,
+    PerBezier = 1,      // one Bezier with its own buffers and draw calls per curve
+    Instanced = 2,      // every curve in one instanced draw call
+    Count,
+};
+
+/*
+ * Accumulates frame times, draw calls, buffer uploads, the GL calls
+ * skipped by the render state tracker and the staging ring's waits and
+ * orphans and logs them every BENCH_LOG_FRAMES frames.
+ */
+struct FrameStats {
+    u64 start;
+    u64 ticks;
+    u32 frames;
+    u64 drawCalls;
+    u64 elidedCalls;
+    u64 uploadedBytes;
+    u32 streamWaits;
+    u32 streamOrphans;
+};
+
+/*
+ * The same set of random curves kept both as individual Bezier values and
+ * in a BezierScene so the two render paths can be compared.  The
+ * instanced path only draws the curves the BVH finds on screen, instances
+ * holds those of the last view box.
+ */
+struct BenchScene {
+    u32              curveCount;
+    Bezier          *beziers;
+    BezierScene      curves;
+    BezierBvh        bvh;
+    BezierInstances  instances;
+    BezierBounds     instancesBox;
+    u32             *visible;
+};
+
+BENCH_DEF BenchScene makeBenchScene(u32           curveCount,
+                                   u32           segments,
+                                   Font         *font,
+                                   StreamBuffer *stream,
+                                   Arena        *scratch,
+                                   RenderState  *state);
+
+/*
+ * Draw the scene with mode and return the number of draw calls issued.
+ * Curves outside the view are skipped in either mode.
+ */
+BENCH_DEF u32 renderBenchScene(BenchScene           *scene,
+                               BenchMode             mode,
+                               BezierShader         *bezierShader,
+                               BezierInstanceShader *instShader,
+                               RenderState          *state,
+                               Font                 *font,
+                               Mat4                 *lineMVP,
+                               Mat4                 *textMVP,
+                               Vec2                  viewport);
+
+/*
+ * Time nearest point queries on pointCount random points indexed by a
+ * PointGrid against a linear scan, and nearest curve queries on a
+ * BezierScene of curveCount random curves with and without a BVH, and
+ * log the results.
+ */
+BENCH_DEF void runPickBench(u32 pointCount, u32 curveCount, f32 radius);
+
+/*
+ * Time intersectBezierScene on one thread and on threadCount threads over
+ * curveCount random curves and over two adversarial sets: curves that
+ * all cross in the middle (every pair is a candidate) and a stack of
+ * nearly parallel curves that cross at shallow angles.  Logs the
+ * candidate pairs tested and intersections per second.
+ */
+BENCH_DEF void runIntersectBench(u32 curveCount, i32 threadCount);
+
+/*
+ * Time stroking curveCount random curves of segments segments, width
+ * world units wide, with every join into one vertex array.  The only
+ * allocation is one arena for the whole scene.
+ */
+BENCH_DEF void runStrokeBench(u32 curveCount, u32 segments, f32 width);
+
+/*
+ * Time placing markers evenly spaced along curveCount random curves,
+ * markers per curve, with arc length tables (including building them)
+ * against brute force: samples points evenly in t and interpolating the
+ * chord lengths.  Logs markers per second and the worst distance of a
+ * marker from where it belongs along the curve, measured on a few
+ * hundred curves against a double precision reference.
+ */
+BENCH_DEF void runLengthBench(u32 curveCount, u32 markers, u32 samples);
+
+/*
+ * Build a path of subpathCount random subpaths from a path with room for
+ * one segment, with every way of starting a subpath: cubicTo before any
+ * moveTo, drawing on after a close and moveTo.  Logs the subpaths whose
+ * points don't add up, then times tessellating the path into segments
+ * steps per curve.
+ */
+BENCH_DEF void runPathBench(u32 subpathCount, u32 segments);
+
+/*
+ * Build ellipseCount random ellipses and elliptic arcs with conicArc and
+ * log how many rational cubics they take against the plain cubics that
+ * stay within a few tolerances of them, and how far the rational ones
+ * are off.
+ * Then evaluate every rational cubic at samples parameters with
+ * evalRationalBezierParams and evalRationalBezierCurves on each
+ * BezierSimd level the CPU has, and log the speed and the points that
+ * differ from evalRationalBezier.
+ */
+BENCH_DEF void runConicBench(u32 ellipseCount, u32 samples);
+
+BENCH_DEF void beginFrameStats(FrameStats *stats);
+BENCH_DEF void endFrameStats(FrameStats         *stats,
+                             char const         *label,
+                             u32                 drawCalls,
+                             RenderState const  *state,
+                             StreamBuffer const *stream);
+
+#endif // GUARD_INCLUDE_BENCH_H
+
+
+#ifdef BENCH_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+#include <SDL_log.h>
+#include <SDL_timer.h>
+
+#if !defined(BENCH_LOG_FRAMES)
+    #define BENCH_LOG_FRAMES 120
+#endif
+
+static f32 benchRandom(f32 range)
+{
+    return (f32(rand()) / f32(RAND_MAX) * 2.0f - 1.0f) * range;
+}
+
+constexpr f32 BENCH_REACH = 150.0f; // control point spread of a random curve
+
+/*
+ * Scene of curveCount random curves, spread out so the curves overlap
+ * about as much at every count.  The same seed gives the same scene.
+ */
+static BezierScene makeRandomBezierScene(u32 curveCount, u32 seed, f32 width)
+{
+    auto spread = sqrtf(f32(curveCount)) * BENCH_REACH * 0.5f;
+    auto scene  = makeBezierScene(curveCount);
+
+    srand(seed);
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        auto origin = vec2(benchRandom(spread), benchRandom(spread));
+        Vec2 cp[4];
+
+        for (auto i = 0; i < 4; ++i)
+            cp[i] = origin + vec2(benchRandom(BENCH_REACH), benchRandom(BENCH_REACH));
+        addBezier(&scene, cp, vec4(0.1f, 0.9f, 0.25f, 1.0f), width);
+    }
+
+    return scene;
+}
+
+BENCH_DEF BenchScene
+makeBenchScene(u32           curveCount,
+               u32           segments,
+               Font         *font,
+               StreamBuffer *stream,
+               Arena        *scratch,
+               RenderState  *state)
+{
+    constexpr f32 SPREAD = 2000.0f;
+    constexpr f32 REACH  = 150.0f;
+
+    auto scene = BenchScene{};
+
+    scene.curveCount = curveCount;
+    scene.beziers    = (Bezier*) malloc(curveCount * sizeof(Bezier));
+    scene.visible    = (u32*) malloc(curveCount * sizeof(u32));
+    scene.curves     = makeBezierScene(curveCount);
+    scene.instances  = makeBezierInstances(curveCount, segments);
+
+    if (scene.beziers == nullptr || scene.visible == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for a benchmark of %u curves.\n", curveCount);
+        exit(EXIT_FAILURE);
+    }
+
+    srand(1234);
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        auto& bez    = scene.beziers[idx];
+        auto  origin = vec2(benchRandom(SPREAD), benchRandom(SPREAD));
+
+        bez = makeBezier(segments);
+        for (auto cp = 0; cp < ARRAY_COUNT(bez.cp); ++cp)
+            bez.cp[cp] = origin + vec2(benchRandom(REACH), benchRandom(REACH));
+
+        bez.setLineSize(1.0f).setLineColor(0.7f, 0.3f, 0.05f, 1.0f);
+        bez.setCurveSize(2.0f).setCurveColor(0.1f, 0.9f, 0.25f, 1.0f);
+        bez.setPointSize(4.0f).setPointColor(0.1f, 0.3f, 0.85f, 1.0f);
+        bez.setTextColor(0.05f, 0.05f, 0.05f, 1.0f);
+        loadBezierVertices(&bez, font, stream, scratch, state);
+
+        addBezier(&scene.curves, bez.cp,
+                  bez.colors[i32(BezierProperty::Curve)],
+                  bez.lineWidth[i32(BezierProperty::Curve)]);
+    }
+
+    buildBezierBvh(&scene.bvh, &scene.curves);
+    // Empty, so the first frame always finds the visible set.
+    scene.instancesBox = BezierBounds{ vec2(1.0f, 1.0f), vec2(-1.0f, -1.0f) };
+
+    return scene;
+}
+
+BENCH_DEF u32
+renderBenchScene(BenchScene           *scene,
+                 BenchMode             mode,
+                 BezierShader         *bezierShader,
+                 BezierInstanceShader *instShader,
+                 RenderState          *state,
+                 Font                 *font,
+                 Mat4                 *lineMVP,
+                 Mat4                 *textMVP,
+                 Vec2                  viewport)
+{
+    auto drawCalls = u32(0);
+
+    if (mode == BenchMode::PerBezier) {
+        for (u32 idx = 0; idx < scene->curveCount; ++idx) {
+            auto bez = &scene->beziers[idx];
+
+            // One per line, curve and point property and one for all labels.
+            if (renderBezier(bez, bezierShader, state, font, lineMVP, textMVP, viewport))
+                drawCalls += u32(ARRAY_COUNT(bez->vao));
+        }
+    } else if (mode == BenchMode::Instanced) {
+        auto view = clipBounds(lineMVP);
+
+        if (view.min.x != scene->instancesBox.min.x || view.min.y != scene->instancesBox.min.y
+         || view.max.x != scene->instancesBox.max.x || view.max.y != scene->instancesBox.max.y) {
+            auto  count  = queryBezierBvh(&scene->bvh, view, scene->visible, scene->curveCount);
+            auto& curves = scene->curves;
+
+            clearBezierInstances(&scene->instances);
+            for (u32 idx = 0; idx < count; ++idx) {
+                auto curve = scene->visible[idx];
+                auto inst  = BezierInstance{};
+
+                for (auto cp = 0; cp < 4; ++cp)
+                    inst.cp[cp] = bezierControlPoint(&curves, curve, cp);
+                inst.weights = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+                inst.color   = curves.colors[curve];
+                inst.width   = curves.widths[curve];
+                addBezierInstance(&scene->instances, inst);
+            }
+            scene->instancesBox = view;
+        }
+
+        if (scene->instances.count > 0) {
+            renderBezierInstances(&scene->instances, instShader, state, lineMVP, viewport);
+            drawCalls += 1;
+        }
+    }
+
+    return drawCalls;
+}
+
+static u32 findNearestLinear(PointGrid const *grid, Vec2 pos, f32 radius)
+{
+    auto best   = POINT_GRID_NONE;
+    auto bestSq = radius * radius;
+
+    for (u32 point = 0; point < grid->count; ++point) {
+        auto dx = grid->x[point] - pos.x;
+        auto dy = grid->y[point] - pos.y;
+        auto sq = dx * dx + dy * dy;
+
+        if (sq <= bestSq) {
+            best   = point;
+            bestSq = sq;
+        }
+    }
+
+    return best;
+}
+
+static void runHoverBench(u32 curveCount, f32 radius)
+{
+    constexpr u32 QUERIES = 1000;
+
+    auto spread = sqrtf(f32(curveCount)) * BENCH_REACH * 0.5f;
+    auto scene  = makeRandomBezierScene(curveCount, 5678, 2.0f);
+    auto bvh    = BezierBvh{};
+    auto freq   = f64(SDL_GetPerformanceFrequency());
+    defer(freeBezierScene(&scene));
+    defer(freeBezierBvh(&bvh));
+
+    auto start = SDL_GetPerformanceCounter();
+    buildBezierBvh(&bvh, &scene);
+    auto buildTicks = SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    refitBezierBvh(&bvh, &scene);
+    auto refitTicks = SDL_GetPerformanceCounter() - start;
+
+    auto hits        = u32(0);
+    auto mismatches  = u32(0);
+    auto linearTicks = u64(0);
+    auto bvhTicks    = u64(0);
+
+    for (u32 idx = 0; idx < QUERIES; ++idx) {
+        auto pos = vec2(benchRandom(spread), benchRandom(spread));
+
+        start = SDL_GetPerformanceCounter();
+        auto linear = nearestBezierInScene(&scene, pos, radius);
+        linearTicks += SDL_GetPerformanceCounter() - start;
+
+        start = SDL_GetPerformanceCounter();
+        auto tree = nearestBezierInBvh(&bvh, &scene, pos, radius);
+        bvhTicks += SDL_GetPerformanceCounter() - start;
+
+        hits       += tree.index >= 0;
+        mismatches += linear.index != tree.index;
+    }
+
+    SDL_Log("hover: %u curves, bvh built in %.1f ms, refit in %.1f ms, %.2f us/query (%u of %u hit), linear %.1f us/query, %u mismatches",
+            curveCount,
+            1000.0 * f64(buildTicks) / freq,
+            1000.0 * f64(refitTicks) / freq,
+            1e6 * f64(bvhTicks) / freq / QUERIES,
+            hits, QUERIES,
+            1e6 * f64(linearTicks) / freq / QUERIES,
+            mismatches);
+}
+
+BENCH_DEF void runPickBench(u32 pointCount, u32 curveCount, f32 radius)
+{
+    constexpr u32 QUERIES        = 100000;
+    constexpr u32 LINEAR_QUERIES = 100;
+
+    // About one point per four cells, a dense but realistic scene.
+    auto spread = sqrtf(f32(pointCount)) * radius;
+    auto grid   = makePointGrid(radius, pointCount);
+    auto freq   = f64(SDL_GetPerformanceFrequency());
+    defer(freePointGrid(&grid));
+
+    srand(4321);
+
+    auto start = SDL_GetPerformanceCounter();
+    for (u32 idx = 0; idx < pointCount; ++idx)
+        addGridPoint(&grid, vec2(benchRandom(spread), benchRandom(spread)));
+    auto buildTicks = SDL_GetPerformanceCounter() - start;
+
+    // Aim next to existing points so most queries hit.
+    auto query = [&](u32 idx) {
+        auto point  = (idx * 2654435761u) % pointCount;
+        auto jitter = vec2(benchRandom(radius), benchRandom(radius));
+
+        return vec2(grid.x[point], grid.y[point]) + jitter;
+    };
+
+    auto hits = u32(0);
+
+    start = SDL_GetPerformanceCounter();
+    for (u32 idx = 0; idx < QUERIES; ++idx)
+        hits += findNearestPoint(&grid, query(idx), radius) != POINT_GRID_NONE;
+    auto gridTicks = SDL_GetPerformanceCounter() - start;
+
+    auto mismatches  = u32(0);
+    auto linearTicks = u64(0);
+
+    for (u32 idx = 0; idx < LINEAR_QUERIES; ++idx) {
+        auto pos = query(idx);
+
+        start = SDL_GetPerformanceCounter();
+        auto linear = findNearestLinear(&grid, pos, radius);
+        linearTicks += SDL_GetPerformanceCounter() - start;
+
+        mismatches += linear != findNearestPoint(&grid, pos, radius);
+    }
+
+    SDL_Log("pick: %u points indexed in %.1f ms, %.1f ns/pick (%u of %u hit), linear scan %.1f ns/pick, %u mismatches",
+            pointCount,
+            1000.0 * f64(buildTicks) / freq,
+            1e9 * f64(gridTicks) / freq / QUERIES,
+            hits, QUERIES,
+            1e9 * f64(linearTicks) / freq / LINEAR_QUERIES,
+            mismatches);
+
+    runHoverBench(curveCount, radius);
+}
+
+static void timeIntersections(char const *label, BezierScene const *scene, i32 threadCount)
+{
+    constexpr f32 TOLERANCE = 0.01f;
+
+    auto bvh  = BezierBvh{};
+    auto hits = BezierIntersections{};
+    auto freq = f64(SDL_GetPerformanceFrequency());
+    defer(freeBezierBvh(&bvh));
+    defer(freeBezierIntersections(&hits));
+
+    buildBezierBvh(&bvh, scene);
+
+    auto start = SDL_GetPerformanceCounter();
+    intersectBezierScene(scene, &bvh, TOLERANCE, 1, &hits);
+    auto singleSec   = f64(SDL_GetPerformanceCounter() - start) / freq;
+    auto singleCnt   = hits.count;
+    auto singlePairs = hits.candidatePairs;
+
+    start = SDL_GetPerformanceCounter();
+    intersectBezierScene(scene, &bvh, TOLERANCE, threadCount, &hits);
+    auto threadSec = f64(SDL_GetPerformanceCounter() - start) / freq;
+
+    SDL_Log("intersect %s: %u curves, %llu of %llu pairs tested, %u intersections (%u on one thread), %u degenerate pairs",
+            label,
+            scene->liveCount,
+            (unsigned long long) hits.candidatePairs,
+            (unsigned long long)(u64(scene->liveCount) * (scene->liveCount - 1) / 2),
+            hits.count, singleCnt,
+            hits.degeneratePairs);
+    SDL_Log("    1 thread %.1f ms, %.2f M pairs/s, %.2f M intersections/s; %d threads %.1f ms, %.2f M pairs/s, %.2f M intersections/s",
+            1000.0 * singleSec,
+            1e-6 * f64(singlePairs) / singleSec,
+            1e-6 * f64(singleCnt) / singleSec,
+            threadCount,
+            1000.0 * threadSec,
+            1e-6 * f64(hits.candidatePairs) / threadSec,
+            1e-6 * f64(hits.count) / threadSec);
+}
+
+BENCH_DEF void runIntersectBench(u32 curveCount, i32 threadCount)
+{
+    auto color = vec4(0.1f, 0.9f, 0.25f, 1.0f);
+
+    // Every pair is a candidate in the adversarial sets, keep them smaller.
+    auto crowdCount = curveCount / 25 > 0 ? curveCount / 25 : 1;
+
+    {
+        auto scene = makeRandomBezierScene(curveCount, 8765, 2.0f);
+        defer(freeBezierScene(&scene));
+
+        timeIntersections("random", &scene, threadCount);
+    }
+    {
+        auto scene = makeBezierScene(crowdCount);
+        defer(freeBezierScene(&scene));
+
+        for (u32 idx = 0; idx < crowdCount; ++idx) {
+            auto angle = benchRandom(PI);
+            auto dir   = vec2(cosf(angle), sinf(angle)) * BENCH_REACH;
+            auto side  = vec2(-dir.y, dir.x) * 0.3f;
+            Vec2 cp[4] = { -1.0f * dir, -0.3f * dir + side, 0.3f * dir - side, dir };
+
+            addBezier(&scene, cp, color, 2.0f);
+        }
+        timeIntersections("crossing", &scene, threadCount);
+    }
+    {
+        auto scene = makeBezierScene(crowdCount);
+        defer(freeBezierScene(&scene));
+
+        for (u32 idx = 0; idx < crowdCount; ++idx) {
+            auto y    = 0.05f * f32(idx);
+            auto wave = BENCH_REACH * (0.2f + 0.001f * benchRandom(1.0f));
+            Vec2 cp[4] = { vec2(-BENCH_REACH, y), vec2(-BENCH_REACH / 3.0f, y + wave), vec2(BENCH_REACH / 3.0f, y - wave), vec2(BENCH_REACH, y) };
+
+            addBezier(&scene, cp, color, 2.0f);
+        }
+        timeIntersections("shallow", &scene, threadCount);
+    }
+}
+
+BENCH_DEF void runStrokeBench(u32 curveCount, u32 segments, f32 width)
+{
+    StrokeJoin const joins[]     = { StrokeJoin::Miter, StrokeJoin::Round, StrokeJoin::Bevel };
+    StrokeCap const  caps[]      = { StrokeCap::Butt,   StrokeCap::Round,  StrokeCap::Square };
+    char const      *joinNames[] = { "miter", "round", "bevel" };
+
+    auto scene = makeRandomBezierScene(curveCount, 2468, width);
+    auto freq  = f64(SDL_GetPerformanceFrequency());
+    defer(freeBezierScene(&scene));
+
+    auto maxVtx = u64(0);
+    for (auto style = 0; style < ARRAY_COUNT(joins); ++style) {
+        auto bound = strokeVertexBound(segments + 1, makeStrokeStyle(width, joins[style], caps[style]));
+
+        maxVtx = bound > maxVtx ? bound : maxVtx;
+    }
+
+    // Room for the polylines, their vertices and the tessellation temporaries.
+    auto points  = u64(curveCount) * (segments + 1);
+    auto arena   = makeArena((points + u64(curveCount) * maxVtx) * sizeof(Vec2) + 3 * curveCount * sizeof(f32) + 4096);
+    auto polyPts = pushArray(&arena, Vec2, points);
+    auto strip   = pushArray(&arena, Vec2, u64(curveCount) * maxVtx);
+    defer(freeArena(&arena));
+
+    if (arena.base == nullptr || polyPts == nullptr || strip == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Not enough memory to stroke %u curves.\n", curveCount);
+        return;
+    }
+
+    tessellateBezierScene(&scene, segments, polyPts, &arena);
+
+    for (auto style = 0; style < ARRAY_COUNT(joins); ++style) {
+        auto stroke  = makeStrokeStyle(width, joins[style], caps[style]);
+        auto written = u64(0);
+        auto start   = SDL_GetPerformanceCounter();
+
+        for (u32 idx = 0; idx < scene.count; ++idx)
+            written += strokePolyline(polyPts + scene.firstVertex[idx], scene.vertexCount[idx], stroke, strip + written);
+
+        auto sec = f64(SDL_GetPerformanceCounter() - start) / freq;
+
+        SDL_Log("stroke %s: %u curves, %llu vertices in %.2f ms, %.1f M vertices/s, %.2f us/curve",
+                joinNames[style],
+                curveCount,
+                (unsigned long long) written,
+                1000.0 * sec,
+                1e-6 * f64(written) / sec,
+                1e6 * sec / curveCount);
+    }
+}
+
+/* Arc length from 0 to t in double precision, 256 Gauss-Legendre panels. */
+static f64 referenceLength(Vec2 const *cp, f64 t)
+{
+    constexpr i32 PANELS = 256;
+
+    static f64 const x[5] = { -0.906179845938664, -0.538469310105683, 0.0, 0.538469310105683, 0.906179845938664 };
+    static f64 const w[5] = {  0.236926885056189,  0.478628670499366, 0.568888888888889, 0.478628670499366, 0.236926885056189 };
+
+    auto dx   = BezierN<2, f64>{ { 3.0 * (f64(cp[1].x) - cp[0].x), 3.0 * (f64(cp[2].x) - cp[1].x), 3.0 * (f64(cp[3].x) - cp[2].x) } };
+    auto dy   = BezierN<2, f64>{ { 3.0 * (f64(cp[1].y) - cp[0].y), 3.0 * (f64(cp[2].y) - cp[1].y), 3.0 * (f64(cp[3].y) - cp[2].y) } };
+    auto half = 0.5 * t / PANELS;
+    auto sum  = 0.0;
+
+    for (auto panel = 0; panel < PANELS; ++panel) {
+        auto middle = (2 * panel + 1) * half;
+
+        for (auto idx = 0; idx < 5; ++idx) {
+            auto at = middle + half * x[idx];
+            auto vx = evalBezierN(dx, at);
+            auto vy = evalBezierN(dy, at);
+
+            sum += w[idx] * sqrt(vx * vx + vy * vy);
+        }
+    }
+
+    return half * sum;
+}
+
+/*
+ * Brute force: samples + 1 points evenly in t, the marker's length is
+ * found between two of them and t interpolated linearly.
+ */
+static void bruteForceParams(Vec2 const *cp, u32 samples, u32 markers, f32 *sampleT, Vec2 *points, f32 *lengths, f32 *outT)
+{
+    for (u32 idx = 0; idx <= samples; ++idx)
+        sampleT[idx] = f32(idx) / f32(samples);
+    evalBezierParams(cp, sampleT, samples + 1, points);
+
+    lengths[0] = 0.0f;
+    for (u32 idx = 1; idx <= samples; ++idx)
+        lengths[idx] = lengths[idx - 1] + sqrtf(len_sq(points[idx] - points[idx - 1]));
+
+    for (u32 marker = 0; marker < markers; ++marker) {
+        auto length = (f32(marker) + 0.5f) / f32(markers) * lengths[samples];
+        auto lo     = u32(0);
+        auto hi     = samples;
+
+        while (hi - lo > 1) {
+            auto mid = (lo + hi) / 2;
+
+            if (lengths[mid] <= length) lo = mid;
+            else                        hi = mid;
+        }
+
+        auto span = lengths[lo + 1] - lengths[lo];
+        auto frac = span > 0.0f ? (length - lengths[lo]) / span : 0.0f;
+
+        outT[marker] = (f32(lo) + frac) / f32(samples);
+    }
+}
+
+BENCH_DEF void runLengthBench(u32 curveCount, u32 markers, u32 samples)
+{
+    constexpr u32 CHECKED = 200;
+
+    auto scene  = makeRandomBezierScene(curveCount, 1357, 2.0f);
+    auto freq   = f64(SDL_GetPerformanceFrequency());
+    auto arena  = makeArena(u64(curveCount) * (4 * sizeof(Vec2) + sizeof(BezierLengthTable))
+                          + u64(markers) * (sizeof(f32) + sizeof(Vec2))
+                          + u64(samples + 1) * (2 * sizeof(f32) + sizeof(Vec2))
+                          + u64(CHECKED) * markers * 2 * sizeof(f32) + 4096);
+    defer(freeBezierScene(&scene));
+    defer(freeArena(&arena));
+
+    auto cps     = pushArray(&arena, Vec2, 4 * u64(curveCount));
+    auto tables  = pushArray(&arena, BezierLengthTable, curveCount);
+    auto targets = pushArray(&arena, f32, markers);
+    auto sampleT = pushArray(&arena, f32, samples + 1);
+    auto points  = pushArray(&arena, Vec2, samples + 1);
+    auto lengths = pushArray(&arena, f32, samples + 1);
+    auto tableT  = pushArray(&arena, f32, u64(CHECKED) * markers);
+    auto bruteT  = pushArray(&arena, f32, u64(CHECKED) * markers);
+
+    if (arena.base == nullptr || cps == nullptr || tables == nullptr || bruteT == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Not enough memory to measure %u curves.\n", curveCount);
+        return;
+    }
+
+    // The tables take control points curve by curve.
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        for (auto i = 0; i < 4; ++i)
+            cps[4 * idx + i] = bezierControlPoint(&scene, idx, i);
+        tables[idx] = BezierLengthTable{};
+    }
+
+    // Only the first CHECKED curves keep their parameters for the accuracy check.
+    auto start = SDL_GetPerformanceCounter();
+
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        auto table = &tables[idx];
+        auto out   = idx < CHECKED ? tableT + u64(idx) * markers : targets;
+
+        updateBezierLengthTable(table, cps + 4 * idx);
+        for (u32 marker = 0; marker < markers; ++marker)
+            targets[marker] = (f32(marker) + 0.5f) / f32(markers) * bezierLength(table);
+        bezierLengthsToParams(table, targets, markers, out);
+    }
+
+    auto tableSec = f64(SDL_GetPerformanceCounter() - start) / freq;
+
+    // Again with every table built, as for curves that didn't move since the last frame.
+    start = SDL_GetPerformanceCounter();
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        auto table = &tables[idx];
+
+        updateBezierLengthTable(table, cps + 4 * idx);
+        for (u32 marker = 0; marker < markers; ++marker)
+            targets[marker] = (f32(marker) + 0.5f) / f32(markers) * bezierLength(table);
+        bezierLengthsToParams(table, targets, markers, targets);
+    }
+
+    auto cachedSec = f64(SDL_GetPerformanceCounter() - start) / freq;
+
+    start = SDL_GetPerformanceCounter();
+    for (u32 idx = 0; idx < curveCount; ++idx) {
+        auto out = idx < CHECKED ? bruteT + u64(idx) * markers : targets;
+
+        bruteForceParams(cps + 4 * idx, samples, markers, sampleT, points, lengths, out);
+    }
+
+    auto bruteSec   = f64(SDL_GetPerformanceCounter() - start) / freq;
+    auto tableError = 0.0;
+    auto bruteError = 0.0;
+    auto checked    = curveCount < CHECKED ? curveCount : CHECKED;
+
+    for (u32 idx = 0; idx < checked; ++idx) {
+        auto cp    = cps + 4 * idx;
+        auto total = referenceLength(cp, 1.0);
+
+        for (u32 marker = 0; marker < markers; ++marker) {
+            auto target = (marker + 0.5) / markers * total;
+            auto atT    = fabs(referenceLength(cp, tableT[u64(idx) * markers + marker]) - target);
+            auto atB    = fabs(referenceLength(cp, bruteT[u64(idx) * markers + marker]) - target);
+
+            tableError = atT > tableError ? atT : tableError;
+            bruteError = atB > bruteError ? atB : bruteError;
+        }
+    }
+
+    auto placed = f64(curveCount) * markers;
+
+    SDL_Log("arc length: %u curves, %u markers each, tables %.1f M markers/s (%.2f us/curve), %.1f M markers/s when built, worst error %.2e",
+            curveCount, markers,
+            1e-6 * placed / tableSec, 1e6 * tableSec / curveCount,
+            1e-6 * placed / cachedSec,
+            tableError);
+    SDL_Log("arc length: brute force of %u samples %.1f M markers/s (%.2f us/curve), worst error %.2e",
+            samples, 1e-6 * placed / bruteSec, 1e6 * bruteSec / curveCount, bruteError);
+}
+
+/* Number of subpaths of path whose layout isn't the 3N + 1 points it claims. */
+static u32 checkBezierPath(BezierPath const *path)
+{
+    auto bad      = u32(0);
+    auto points   = u32(0);
+    auto segments = u32(0);
+
+    for (u32 idx = 0; idx < path->subpathCount; ++idx) {
+        auto sub   = path->subpaths[idx];
+        auto first = path->points[sub.firstPoint];
+        auto last  = path->points[sub.firstPoint + 3 * sub.segmentCount];
+
+        if (sub.firstPoint != points || sub.firstSegment != segments)
+            ++bad;
+        else if (sub.isClosed && (first.x != last.x || first.y != last.y))
+            ++bad;
+
+        points   += 3 * sub.segmentCount + 1;
+        segments += sub.segmentCount;
+    }
+
+    if (points != path->pointCount || segments != path->segmentCount)
+        ++bad;
+    if (path->pointCount > path->pointCapacity || path->segmentCount > path->segmentCapacity)
+        ++bad;
+
+    return bad;
+}
+
+BENCH_DEF void runPathBench(u32 subpathCount, u32 segments)
+{
+    constexpr f32 SPREAD = 2000.0f;
+    constexpr f32 REACH  = 50.0f;
+    constexpr u32 MOVES  = 8;
+
+    // Grows from one segment so every way of opening a subpath reallocates.
+    auto path = makeBezierPath(1);
+    defer(freeBezierPath(&path));
+
+    srand(1357);
+    auto pen = vec2(0.0f, 0.0f);
+
+    for (u32 idx = 0; idx < subpathCount; ++idx) {
+        auto isClosed = path.subpathCount > 0 && path.subpaths[path.subpathCount - 1].isClosed;
+
+        // The first subpath starts at the origin, one after a close where that one started.
+        if (idx > 0 && !(isClosed && rand() % 2 == 0)) {
+            pen = vec2(benchRandom(SPREAD), benchRandom(SPREAD));
+            bezierPathMoveTo(&path, pen);
+        } else if (idx > 0) {
+            pen = path.points[path.subpaths[path.subpathCount - 1].firstPoint];
+        }
+
+        for (auto move = 1 + u32(rand()) % MOVES; move > 0; --move) {
+            auto to = pen + vec2(benchRandom(REACH), benchRandom(REACH));
+
+            if (rand() % 3 == 0) {
+                bezierPathLineTo(&path, to);
+            } else {
+                bezierPathCubicTo(&path,
+                                  pen + vec2(benchRandom(REACH), benchRandom(REACH)),
+                                  to + vec2(benchRandom(REACH), benchRandom(REACH)),
+                                  to);
+            }
+            pen = to;
+        }
+
+        if (rand() % 2 == 0)
+            bezierPathClose(&path);
+    }
+
+    auto bad = checkBezierPath(&path);
+
+    if (bad > 0 || path.subpathCount != subpathCount) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "path: %u of %u subpaths are laid out wrong.\n", bad, path.subpathCount);
+    }
+
+    auto bound = bezierPathVertexBound(&path, segments);
+    auto arena = makeArena(size_t(bound) * sizeof(Vec2) + size_t(path.subpathCount) * (sizeof(GLint) + sizeof(GLsizei))
+                           + segments * sizeof(f32) + 4096);
+    auto verts  = pushArray(&arena, Vec2, bound);
+    auto firsts = pushArray(&arena, GLint, path.subpathCount);
+    auto counts = pushArray(&arena, GLsizei, path.subpathCount);
+    defer(freeArena(&arena));
+
+    if (arena.base == nullptr || verts == nullptr || firsts == nullptr || counts == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Not enough memory to tessellate %u subpaths.\n", path.subpathCount);
+        return;
+    }
+
+    auto start   = SDL_GetPerformanceCounter();
+    auto written = tessellateBezierPath(&path, segments, verts, firsts, counts, &arena);
+    auto sec     = f64(SDL_GetPerformanceCounter() - start) / f64(SDL_GetPerformanceFrequency());
+
+    SDL_Log("path: %u subpaths, %u segments, %u vertices in %.2f ms, %.1f M vertices/s, layout %s",
+            path.subpathCount,
+            path.segmentCount,
+            written,
+            1000.0 * sec,
+            1e-6 * f64(written) / sec,
+            bad == 0 ? "ok" : "wrong");
+}
+
+/*
+ * An ellipse of radii turned by rotation around center, as conicArc
+ * takes it.
+ */
+struct BenchEllipse {
+    Vec2 center;
+    Vec2 radii;
+    f32  rotation;
+};
+
+static Vec2 benchEllipsePoint(BenchEllipse const &ellipse, f32 angle)
+{
+    auto x = ellipse.radii.x * cosf(angle);
+    auto y = ellipse.radii.y * sinf(angle);
+    auto c = cosf(ellipse.rotation);
+    auto s = sinf(ellipse.rotation);
+
+    return ellipse.center + vec2(c * x - s * y, s * x + c * y);
+}
+
+/* Derivative of benchEllipsePoint with respect to angle. */
+static Vec2 benchEllipseTangent(BenchEllipse const &ellipse, f32 angle)
+{
+    auto x = -ellipse.radii.x * sinf(angle);
+    auto y = ellipse.radii.y * cosf(angle);
+    auto c = cosf(ellipse.rotation);
+    auto s = sinf(ellipse.rotation);
+
+    return vec2(c * x - s * y, s * x + c * y);
+}
+
+/* Distance of pt from the ellipse, to first order, in double precision. */
+static f64 benchEllipseError(BenchEllipse const &ellipse, Vec2 pt)
+{
+    auto c  = cos(f64(ellipse.rotation));
+    auto s  = sin(f64(ellipse.rotation));
+    auto dx = f64(pt.x) - ellipse.center.x;
+    auto dy = f64(pt.y) - ellipse.center.y;
+    auto x  = (c * dx + s * dy) / ellipse.radii.x;
+    auto y  = (c * dy - s * dx) / ellipse.radii.y;
+    auto gx = 2.0 * x / ellipse.radii.x;
+    auto gy = 2.0 * y / ellipse.radii.y;
+
+    return fabs(x * x + y * y - 1.0) / sqrt(gx * gx + gy * gy);
+}
+
+/*
+ * Fewest plain cubics that keep the arc within tolerance, each the
+ * affine image of the usual circle arc with handles 4/3 tan(step / 4).
+ * The count doesn't depend on where the ellipse is, so it's measured
+ * around the origin where f32 has the precision for small tolerances.
+ */
+static u32 cubicArcCount(BenchEllipse ellipse, f32 start, f32 sweep, f32 tolerance)
+{
+    constexpr u32 MAX_CUBICS = 256;
+    constexpr u32 CHECKS     = 16;  // points checked per cubic
+
+    ellipse.center = vec2(0.0f, 0.0f);
+
+    for (u32 count = 1; count < MAX_CUBICS; ++count) {
+        auto step   = sweep / f32(count);
+        auto handle = 4.0f / 3.0f * tanf(0.25f * step);
+        auto worst  = 0.0;
+
+        for (u32 seg = 0; seg < count && worst <= tolerance; ++seg) {
+            auto from  = start + f32(seg) * step;
+            auto p0    = benchEllipsePoint(ellipse, from);
+            auto p3    = benchEllipsePoint(ellipse, from + step);
+            auto cubic = CubicBezier{ { p0,
+                                        p0 + handle * benchEllipseTangent(ellipse, from),
+                                        p3 - handle * benchEllipseTangent(ellipse, from + step),
+                                        p3 } };
+
+            for (u32 check = 1; check < CHECKS; ++check) {
+                auto error = benchEllipseError(ellipse, evalBezierN(cubic, f32(check) / f32(CHECKS)));
+
+                worst = error > worst ? error : worst;
+            }
+        }
+
+        if (worst <= tolerance)
+            return count;
+    }
+
+    return MAX_CUBICS;
+}
+
+BENCH_DEF void runConicBench(u32 ellipseCount, u32 samples)
+{
+    constexpr f32 SPREAD = 2000.0f;
+
+    // World units, a pixel at 10x, 100x and 1000x zoom.
+    f32 const tolerances[] = { 0.1f, 0.01f, 0.001f };
+
+    char const *levelNames[] = { "scalar", "sse", "avx2" };
+
+    if (ellipseCount == 0 || samples == 0)
+        return;
+
+    auto maxCurves = u64(ellipseCount) * BEZIER_CONIC_MAX_SEGMENTS;
+    auto arena     = makeArena(maxCurves * (sizeof(RationalCubic) + sizeof(u32) + 15 * sizeof(f32))
+                             + u64(ellipseCount) * sizeof(BenchEllipse)
+                             + u64(samples) * (sizeof(f32) + sizeof(Vec2)) + 4096);
+    defer(freeArena(&arena));
+
+    // The same curves are also laid out for evalRationalBezierCurves, each at its own parameter.
+    auto soa      = RationalBezierSoA{};
+    auto cubics   = pushArray(&arena, RationalCubic, maxCurves);
+    auto owners   = pushArray(&arena, u32, maxCurves);
+    auto ellipses = pushArray(&arena, BenchEllipse, ellipseCount);
+    auto sampleT  = pushArray(&arena, f32, samples);
+    auto points   = pushArray(&arena, Vec2, samples);
+    auto curveT   = pushArray(&arena, f32, maxCurves);
+    auto outX     = pushArray(&arena, f32, maxCurves);
+    auto outY     = pushArray(&arena, f32, maxCurves);
+
+    for (auto cp = 0; cp < 4; ++cp) {
+        soa.x[cp] = pushArray(&arena, f32, maxCurves);
+        soa.y[cp] = pushArray(&arena, f32, maxCurves);
+        soa.w[cp] = pushArray(&arena, f32, maxCurves);
+    }
+
+    if (arena.base == nullptr || cubics == nullptr || soa.w[3] == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Not enough memory for %u ellipses.\n", ellipseCount);
+        return;
+    }
+
+    auto curveCount = u32(0);
+    u64 cubicCounts[ARRAY_COUNT(tolerances)] = {};
+
+    // Every other one a full ellipse, the rest arcs of any sweep in either direction.
+    srand(9753);
+    for (u32 idx = 0; idx < ellipseCount; ++idx) {
+        auto& ellipse = ellipses[idx];
+
+        ellipse.center   = vec2(benchRandom(SPREAD), benchRandom(SPREAD));
+        ellipse.radii    = vec2(110.0f + benchRandom(100.0f), 110.0f + benchRandom(100.0f));
+        ellipse.rotation = benchRandom(PI);
+
+        auto start = benchRandom(PI);
+        auto sweep = idx % 2 == 0 ? 2.0f * PI : benchRandom(2.0f * PI);
+
+        RationalQuadratic arcs[BEZIER_CONIC_MAX_SEGMENTS];
+
+        auto count = conicArc(ellipse.center, ellipse.radii, ellipse.rotation, start, sweep, arcs);
+
+        for (u32 arc = 0; arc < count; ++arc) {
+            cubics[curveCount] = elevateBezier(arcs[arc]);
+            owners[curveCount] = idx;
+            ++curveCount;
+        }
+        for (auto tol = 0; tol < ARRAY_COUNT(tolerances); ++tol)
+            cubicCounts[tol] += cubicArcCount(ellipse, start, sweep, tolerances[tol]);
+    }
+
+    // Both ends included.
+    for (u32 idx = 0; idx < samples; ++idx)
+        sampleT[idx] = samples > 1 ? f32(idx) / f32(samples - 1) : 0.0f;
+
+    auto worst = 0.0;
+
+    for (u32 curve = 0; curve < curveCount; ++curve) {
+        for (u32 idx = 0; idx < samples; ++idx) {
+            auto error = benchEllipseError(ellipses[owners[curve]], evalRationalBezier(cubics[curve], sampleT[idx]));
+
+            worst = error > worst ? error : worst;
+        }
+    }
+
+    SDL_Log("conic: %u ellipses and arcs in %u rational cubics (%.2f each), worst distance %.2e",
+            ellipseCount, curveCount, f64(curveCount) / ellipseCount, worst);
+
+    for (auto tol = 0; tol < ARRAY_COUNT(tolerances); ++tol) {
+        SDL_Log("conic: plain cubics within %.3f take %llu (%.2f each), %.2fx the rational ones",
+                tolerances[tol],
+                (unsigned long long) cubicCounts[tol],
+                f64(cubicCounts[tol]) / ellipseCount,
+                f64(cubicCounts[tol]) / curveCount);
+    }
+
+    soa.count = curveCount;
+    for (u32 curve = 0; curve < curveCount; ++curve) {
+        for (auto cp = 0; cp < 4; ++cp) {
+            soa.x[cp][curve] = cubics[curve].cp[cp].x;
+            soa.y[cp][curve] = cubics[curve].cp[cp].y;
+            soa.w[cp][curve] = cubics[curve].cp[cp].z;
+        }
+        curveT[curve] = sampleT[curve % samples];
+    }
+
+    // Levels above what the CPU has are clamped, so this finds the widest.
+    auto level = bezierSimdLevel();
+    setBezierSimdLevel(BezierSimd::AVX2);
+    auto maxLevel = bezierSimdLevel();
+    defer(setBezierSimdLevel(level));
+
+    for (auto simd = i32(BezierSimd::Scalar); simd <= i32(maxLevel); ++simd) {
+        setBezierSimdLevel(BezierSimd(simd));
+
+        auto paramsDiffer = u64(0);
+        auto ticks        = u64(0);
+
+        for (u32 curve = 0; curve < curveCount; ++curve) {
+            auto start = SDL_GetPerformanceCounter();
+            evalRationalBezierParams(cubics[curve].cp, sampleT, samples, points);
+            ticks += SDL_GetPerformanceCounter() - start;
+
+            for (u32 idx = 0; idx < samples; ++idx) {
+                auto ref = evalRationalBezier(cubics[curve], sampleT[idx]);
+
+                paramsDiffer += points[idx].x != ref.x || points[idx].y != ref.y;
+            }
+        }
+
+        auto sec = f64(ticks) / f64(SDL_GetPerformanceFrequency());
+
+        evalRationalBezierCurves(&soa, curveT, outX, outY);
+
+        auto curvesDiffer = u32(0);
+
+        for (u32 curve = 0; curve < curveCount; ++curve) {
+            auto ref = evalRationalBezier(cubics[curve], curveT[curve]);
+
+            curvesDiffer += outX[curve] != ref.x || outY[curve] != ref.y;
+        }
+
+        SDL_Log("conic %s: %.1f M points/s, %llu of %llu points and %u of %u curves differ from evalRationalBezier",
+                levelNames[simd],
+                1e-6 * f64(curveCount) * samples / sec,
+                (unsigned long long) paramsDiffer, (unsigned long long)(u64(curveCount) * samples),
+                curvesDiffer, curveCount);
+    }
+}
+
+BENCH_DEF void beginFrameStats(FrameStats *stats)
+{
+    stats->start = SDL_GetPerformanceCounter();
+}
+
+BENCH_DEF void endFrameStats(FrameStats         *stats,
+                             char const         *label,
+                             u32                 drawCalls,
+                             RenderState const  *state,
+                             StreamBuffer const *stream)
+{
+    stats->ticks         += SDL_GetPerformanceCounter() - stats->start;
+    stats->drawCalls     += drawCalls;
+    stats->elidedCalls   += state->elidedCalls;
+    stats->uploadedBytes += state->uploadedBytes;
+    stats->streamWaits   += stream->waits;
+    stats->streamOrphans += stream->orphans;
+    stats->frames        += 1;
+
+    if (stats->frames < BENCH_LOG_FRAMES)
+        return;
+
+    auto ms = 1000.0 * f64(stats->ticks) / f64(SDL_GetPerformanceFrequency());
+
+    SDL_Log("%s: %.3f ms/frame, %llu draw calls/frame, %llu elided GL calls/frame, %llu bytes uploaded/frame, "
+            "%u staging waits and %u orphans in %u frames",
+            label,
+            ms / stats->frames,
+            (unsigned long long)(stats->drawCalls / stats->frames),
+            (unsigned long long)(stats->elidedCalls / stats->frames),
+            (unsigned long long)(stats->uploadedBytes / stats->frames),
+            stats->streamWaits,
+            stats->streamOrphans,
+            stats->frames);
+
+    *stats = FrameStats{};
+}
+
+#endif // BENCH_IMPLEMENTATION
@@ -9,6 +9,84 @@
 
 #include <glad/glad.h>
 
+#include "render_state.h"
+#include "stream_buffer.h"
+#include "stroke.h"
+#include "bezier_length.h"
+
+#if !defined(BEZIER_FORWARD_DIFF_EPSILON)
+    #define BEZIER_FORWARD_DIFF_EPSILON 1e-5f   // drift relative to the largest control point coordinate
+#endif
+
+#if !defined(BEZIER_FORWARD_DIFF_RUN)
+    #define BEZIER_FORWARD_DIFF_RUN 32          // steps between exact points
+#endif
+
+#if !defined(BEZIER_ADAPTIVE_MAX_DEPTH)
+    #define BEZIER_ADAPTIVE_MAX_DEPTH 10    // at most 2^10 segments
+#endif
+
+enum class BezierTessellation : i32 {
+    DeCasteljau       = 0,
+    /*
+     * Walk the curve with third order forward differences, restarted from
+     * an exact point every BEZIER_FORWARD_DIFF_RUN steps.  Falls back to
+     * de Casteljau when a run drifts further than BEZIER_FORWARD_DIFF_EPSILON
+     * relative to the control points.
+     */
+    ForwardDifference = 1,
+    /*
+     * Subdivide until every piece is within Bezier::flatness pixels of a
+     * straight line.  Ignores Bezier::segments.
+     */
+    Adaptive          = 2,
+    /*
+     * Evaluate the curve in the vertex shader from the control points.
+     * Nothing is tessellated or uploaded on the CPU, the curve is a line
+     * strip of glLineWidth pixels.
+     */
+    Gpu               = 3,
+    /*
+     * Bezier::segments steps of equal arc length instead of equal steps
+     * in t, see bezier_length.h.
+     */
+    ArcLength         = 4,
+};
+
+/*
+ * How a tessellated curve is drawn, BezierTessellation::Gpu ignores it.
+ */
+enum class BezierStroke : i32 {
+    /* Stroked into triangles on the CPU, see stroke.h. */
+    Triangles = 0,
+    /*
+     * A quad around every segment of the polyline, the fragment shader
+     * covers pixels by their distance to the segment.  Anti-aliased at
+     * any width without MSAA or line smoothing, and the width and caps
+     * are uniforms.  Joins are always round.
+     */
+    Distance  = 1,
+};
+
+/*
+ * Labels are drawn as one instance per character.  Each instance holds
+ * the control point the label belongs to, the glyph quad relative to it
+ * (in text space) and the glyph's rectangle in the font atlas.
+ */
+constexpr i32 BEZIER_LABEL_CHARS = 19;  // per control point
+constexpr i32 BEZIER_GLYPH_F32   = 2 + 4 + 4;
+
+/*
+ * Last laid out label of a control point.  Every label owns a fixed slot
+ * of BEZIER_LABEL_CHARS glyphs in the text buffer, unused glyphs are
+ * zero sized, so a label can be rewritten without touching the others.
+ */
+struct BezierLabel {
+    Vec2 anchor;
+    char text[BEZIER_LABEL_CHARS + 1];
+    f32  glyphs[BEZIER_LABEL_CHARS * BEZIER_GLYPH_F32];
+};
+
 enum class BezierProperty : i32 {
     Line  = 0,      // line that connects control points
     Curve = 1,
@@ -16,6 +94,8 @@ enum class BezierProperty : i32 {
     Text  = 3,
 };
 
+struct Font;
+
 struct Bezier {
     Vec2 cp[4];
     Vec4 colors[4];
@@ -24,13 +104,48 @@ struct Bezier {
     /* Don't change after making the quad. */
     u32 segments = 24;
 
+    BezierTessellation tessellation = BezierTessellation::DeCasteljau;
+
+    /* Adaptive tessellation tolerance in pixels and the current pixels per world unit. */
+    f32 flatness    = 0.25f;
+    f32 screenScale = 1.0f;
+
+    /*
+     * Unless tessellated on the GPU the curve is stroked lineWidth[Curve]
+     * pixels wide.  Triangles are stroked again whenever the scale changes.
+     */
+    BezierStroke curveStroke = BezierStroke::Distance;
+    StrokeJoin   curveJoin   = StrokeJoin::Round;
+    StrokeCap    curveCap    = StrokeCap::Round;
+
     GLuint  vao[4];
+    GLuint  strokeVao;          // vbo[Curve] as one instance per segment
     GLuint  vbo[4];
     GLsizei indexCount[4];
-    GLsizei textIndexCount[4];
-    GLsizei textCharCount[4];
+    GLsizei vertexCapacity[4];
     GLenum  drawType[4];
 
+    /* Built on the first arc length tessellation after cp changes. */
+    BezierLengthTable arcLength;
+
+    BezierLabel labels[4];
+    Font const *labelFont;      // font the labels were laid out with
+
+    /*
+     * Bit per BezierProperty whose buffer has to be rebuilt and bit per
+     * control point that moved since the last updateBezierVertices.
+     * Colors and sizes are uniforms and never dirty a buffer, except the
+     * size of a stroked curve.
+     */
+    u32 dirtyProperties;
+    u32 dirtyPoints;
+
+    Bezier& setControlPoint(i32 idx, Vec2 pos) {
+        cp[idx]      = pos;
+        dirtyPoints |= 1u << idx;
+        return *this;
+    }
+
     Bezier& setLineColor(f32 r, f32 g, f32 b, f32 a) {
         colors[i32(BezierProperty::Line)] = vec4(r,g,b,a);
         return *this;
@@ -46,11 +161,38 @@ struct Bezier {
         return *this;
     }
 
+    bool isStrokedOnCpu() const {
+        return tessellation != BezierTessellation::Gpu && curveStroke == BezierStroke::Triangles;
+    }
+
     Bezier& setCurveSize(f32 size) {
+        if (lineWidth[i32(BezierProperty::Curve)] != size && isStrokedOnCpu())
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
         lineWidth[i32(BezierProperty::Curve)] = size;
         return *this;
     }
 
+    Bezier& setCurveStroke(BezierStroke stroke) {
+        if (curveStroke != stroke)
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        curveStroke = stroke;
+        return *this;
+    }
+
+    Bezier& setCurveJoin(StrokeJoin join) {
+        if (curveJoin != join && isStrokedOnCpu())
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        curveJoin = join;
+        return *this;
+    }
+
+    Bezier& setCurveCap(StrokeCap cap) {
+        if (curveCap != cap && isStrokedOnCpu())
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        curveCap = cap;
+        return *this;
+    }
+
     Bezier& setPointColor(f32 r, f32 g, f32 b, f32 a) {
         colors[i32(BezierProperty::Point)] = vec4(r,g,b,a);
         return *this;
@@ -61,6 +203,29 @@ struct Bezier {
         return *this;
     }
 
+    Bezier& setTessellation(BezierTessellation mode) {
+        if (tessellation != mode)
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        tessellation = mode;
+        return *this;
+    }
+
+    Bezier& setFlatness(f32 pixels) {
+        if (flatness != pixels && tessellation == BezierTessellation::Adaptive)
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        flatness = pixels;
+        return *this;
+    }
+
+    Bezier& setScreenScale(f32 pixelsPerUnit) {
+        auto isAdaptive = tessellation == BezierTessellation::Adaptive;
+
+        if (screenScale != pixelsPerUnit && (isStrokedOnCpu() || isAdaptive))
+            dirtyProperties |= 1u << i32(BezierProperty::Curve);
+        screenScale = pixelsPerUnit;
+        return *this;
+    }
+
     Bezier& setTextColor(f32 r, f32 g, f32 b, f32 a) {
         colors[i32(BezierProperty::Text)] = vec4(r,g,b,a);
         return *this;
@@ -72,18 +237,43 @@ struct BezierShader {
     GLuint lineMVP_uniform;
     GLuint lineColor_uniform;
 
+    GLuint curveProgramId;
+    GLuint curveMVP_uniform;
+    GLuint curveColor_uniform;
+    GLuint curveControlPoints_uniform;
+    GLuint curveSegments_uniform;
+
+    GLuint strokeProgramId;
+    GLuint strokeMVP_uniform;
+    GLuint strokeViewport_uniform;
+    GLuint strokeWidth_uniform;
+    GLuint strokeCap_uniform;
+    GLuint strokeColor_uniform;
+
     GLuint textProgramId;
     GLuint textMVP_uniform;
-    GLuint textOffset_uniform;
+    GLuint textLineMVP_uniform;
     GLuint textColor_uniform;
     GLuint textTexture_uniform;
 };
 
-struct Font;
-
 BEZIER_DEF Bezier makeBezier(u32 segments);
-BEZIER_DEF void   loadBezierVertices(Bezier *bez, Font *font);
-BEZIER_DEF void   renderBezier(Bezier* bezier, BezierShader* shader, Font* font, Mat4* lineMVP, Mat4* textMVP);
+/*
+ * Tessellate and upload everything.
+ */
+BEZIER_DEF void   loadBezierVertices(Bezier *bez, Font *font, StreamBuffer *stream, Arena *scratch, RenderState *state);
+
+/*
+ * Rebuild and upload only what the dirty bits cover, a moved control
+ * point only uploads the vertices it is part of.  Labels are only laid
+ * out again when their text changes.
+ */
+BEZIER_DEF void   updateBezierVertices(Bezier *bez, Font *font, StreamBuffer *stream, Arena *scratch, RenderState *state);
+/*
+ * Draw the curve unless the box around its control points and labels is
+ * off screen.  Returns whether anything was drawn.
+ */
+BEZIER_DEF bool   renderBezier(Bezier* bezier, BezierShader* shader, RenderState* state, Font* font, Mat4* lineMVP, Mat4* textMVP, Vec2 viewport);
 
 #endif // GUARD_BEZIER_H 
 
@@ -92,18 +282,106 @@ BEZIER_DEF void   renderBezier(Bezier* bezier, BezierShader* shader, Font* font,
 
 #ifdef BEZIER_IMPLEMENTATION
 
+#include <string.h>
+#include <math.h>
+#include <SDL_log.h>
+
 #include "font.h"
+#include "bezier_batch.h"
+
+/*
+ * Fill out with segments + 1 points of the curve at uniform steps in t
+ * using forward differences.  Every BEZIER_FORWARD_DIFF_RUN steps the
+ * walk restarts from a point evaluated with de Casteljau, so the float
+ * drift stays bounded however many segments there are.  Returns false if
+ * a run still drifts further than BEZIER_FORWARD_DIFF_EPSILON times the
+ * largest control point coordinate.
+ */
+static bool forwardDifference(Vec2 const *cp, u32 segments, Vec2 *out)
+{
+    // Power basis coefficients, P(t) = a*t^3 + b*t^2 + c*t + d.
+    auto a = cp[3] - cp[0] + 3.0f * (cp[1] - cp[2]);
+    auto b = 3.0f * (cp[2] - 2.0f * cp[1] + cp[0]);
+    auto c = 3.0f * (cp[1] - cp[0]);
+
+    auto curve = CubicBezier{ { cp[0], cp[1], cp[2], cp[3] } };
+    auto reach = 0.0f;
+
+    // Rounding grows with the magnitude of the coordinates, not the size
+    // of the curve, so that's what the drift is measured against.
+    for (auto idx = 0; idx < 4; ++idx)
+        reach = max_of(reach, max_of(fabsf(cp[idx].x), fabsf(cp[idx].y)));
+
+    auto tol = BEZIER_FORWARD_DIFF_EPSILON * reach;
+    auto h   = 1.0f / f32(segments);
+    auto h2  = h * h;
+    auto h3  = h2 * h;
+    auto d3  = 6.0f * h3 * a;
+
+    out[0] = cp[0];
+    for (u32 first = 0; first < segments; first += BEZIER_FORWARD_DIFF_RUN) {
+        auto last = segments - first > BEZIER_FORWARD_DIFF_RUN ? first + BEZIER_FORWARD_DIFF_RUN : segments;
+        auto t    = f32(first) / f32(segments);
+        auto pt   = out[first];
+        auto d1   = (3.0f * t * (t + h) + h2) * h * a + (2.0f * t + h) * h * b + h * c;
+        auto d2   = (t + h) * 6.0f * h2 * a + 2.0f * h2 * b;
+
+        for (u32 seg = first + 1; seg < last; ++seg) {
+            pt += d1;
+            d1 += d2;
+            d2 += d3;
+            out[seg] = pt;
+        }
+        pt += d1;
 
-static Vec2 bezier3(f32 scale, Vec2 c1, Vec2 c2, Vec2 c3, Vec2 c4)
+        auto exact = last == segments ? cp[3] : evalBezierN(curve, f32(last) / f32(segments));
+        if (len_sq(pt - exact) > tol * tol)
+            return false;
+        out[last] = exact;
+    }
+
+    return true;
+}
+
+/*
+ * Append the end points of the flat pieces of the curve cp to out.  The
+ * test is the usual bound on the distance of the inner control points
+ * from the chord, tolSq16 is 16 times the squared tolerance.
+ */
+static void adaptiveSubdivide(Vec2 const *cp, f32 tolSq16, i32 depth, Vec2 *out, u32 *count)
 {
-    auto a = lerp(scale, c1, c2);
-    auto b = lerp(scale, c2, c3);
-    auto c = lerp(scale, c3, c4);
-    auto d = lerp(scale, a, b);
-    auto e = lerp(scale, b, c);
-    auto f = lerp(scale, d, e);
-
-    return f;
+    auto u = 3.0f * cp[1] - 2.0f * cp[0] - cp[3];
+    auto v = 3.0f * cp[2] - 2.0f * cp[3] - cp[0];
+    auto d = max_of(u.x * u.x, v.x * v.x) + max_of(u.y * u.y, v.y * v.y);
+
+    if (d <= tolSq16 || depth >= BEZIER_ADAPTIVE_MAX_DEPTH) {
+        out[(*count)++] = cp[3];
+        return;
+    }
+
+    auto a = lerp(0.5f, cp[0], cp[1]);
+    auto b = lerp(0.5f, cp[1], cp[2]);
+    auto c = lerp(0.5f, cp[2], cp[3]);
+    auto e = lerp(0.5f, a, b);
+    auto f = lerp(0.5f, b, c);
+    auto m = lerp(0.5f, e, f);
+
+    Vec2 left[4]  = { cp[0], a, e, m };
+    Vec2 right[4] = { m, f, c, cp[3] };
+
+    adaptiveSubdivide(left,  tolSq16, depth + 1, out, count);
+    adaptiveSubdivide(right, tolSq16, depth + 1, out, count);
+}
+
+static u32 adaptiveTessellate(Bezier const *bez, Vec2 *out)
+{
+    auto tol   = bez->flatness / max_of(bez->screenScale, 1e-6f);
+    auto count = u32(1);
+
+    out[0] = bez->cp[0];
+    adaptiveSubdivide(bez->cp, 16.0f * tol * tol, 0, out, &count);
+
+    return count;
 }
 
 BEZIER_DEF Bezier makeBezier(u32 segments)
@@ -117,7 +395,9 @@ BEZIER_DEF Bezier makeBezier(u32 segments)
     auto quad   = Bezier{};
     auto bufCnt = ARRAY_COUNT(quad.vao);
 
-    quad.segments = segments;
+    quad.segments        = segments;
+    quad.dirtyProperties = (1u << ARRAY_COUNT(quad.vao)) - 1;
+    quad.dirtyPoints     = (1u << ARRAY_COUNT(quad.cp)) - 1;
 
     quad.cp[0] = vec2(120.0f, 160.0f);
     quad.cp[1] = vec2(35.0f,  200.0f);
@@ -143,8 +423,9 @@ BEZIER_DEF Bezier makeBezier(u32 segments)
     glBindVertexArray(0);
 
     // vertex array for the bezier curve itself
-    quad.indexCount[CURVE] = segments + 1;
-    quad.drawType[CURVE]   = GL_LINE_STRIP;
+    quad.indexCount[CURVE]     = segments + 1;
+    quad.vertexCapacity[CURVE] = segments + 1;
+    quad.drawType[CURVE]       = GL_LINE_STRIP;
     glBindVertexArray(quad.vao[CURVE]);
     glBindBuffer(GL_ARRAY_BUFFER, quad.vbo[CURVE]);
     glBufferData(GL_ARRAY_BUFFER, quad.indexCount[CURVE] * VTX_SZ, nullptr, GL_DYNAMIC_DRAW);
@@ -152,6 +433,18 @@ BEZIER_DEF Bezier makeBezier(u32 segments)
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
 
+    // The same points as instances, segment n reads points n to n + 3 of
+    // the polyline with its end points repeated.
+    glGenVertexArrays(1, &quad.strokeVao);
+    glBindVertexArray(quad.strokeVao);
+    glBindBuffer(GL_ARRAY_BUFFER, quad.vbo[CURVE]);
+    for (GLuint attr = 0; attr < 4; ++attr) {
+        glVertexAttribPointer(attr, 2, GL_FLOAT, GL_FALSE, VTX_SZ, (GLvoid*) (attr * sizeof(Vec2)));
+        glVertexAttribDivisor(attr, 1);
+        glEnableVertexAttribArray(attr);
+    }
+    glBindVertexArray(0);
+
     // vertex array for the control point end points
     quad.indexCount[POINT] = 4; // 4 vertices
     quad.drawType[POINT]   = GL_POINTS;
@@ -162,114 +455,210 @@ BEZIER_DEF Bezier makeBezier(u32 segments)
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
 
-    // vertex array for the control point text
-    // TODO: Track max number of characters?  How to enforce at app level?
-    quad.indexCount[TEXT] = 4 * 4 * 19; // 4 vertices for 4 sets where each set is 19 characters each.
-    quad.drawType[TEXT]   = GL_QUADS;
+    // vertex array for the control point text, one glyph instance per character
+    constexpr GLsizei GLYPH_SZ = BEZIER_GLYPH_F32 * sizeof(f32);
+
+    quad.indexCount[TEXT] = 0;
+    quad.drawType[TEXT]   = GL_TRIANGLE_STRIP;
     glBindVertexArray(quad.vao[TEXT]);
     glBindBuffer(GL_ARRAY_BUFFER, quad.vbo[TEXT]);
-    glBufferData(GL_ARRAY_BUFFER, quad.indexCount[TEXT] * VTX_SZ * 2, nullptr, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof f32, 0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof f32, (GLvoid*) (2 * sizeof f32));
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
+    glBufferData(GL_ARRAY_BUFFER, BEZIER_LABEL_CHARS * ARRAY_COUNT(quad.cp) * GLYPH_SZ, nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, GLYPH_SZ, 0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, GLYPH_SZ, (GLvoid*) (2 * sizeof(f32)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, GLYPH_SZ, (GLvoid*) (6 * sizeof(f32)));
+    for (GLuint attr = 0; attr < 3; ++attr) {
+        glVertexAttribDivisor(attr, 1);
+        glEnableVertexAttribArray(attr);
+    }
     glBindVertexArray(0);
 
     return quad;
 }
 
-BEZIER_DEF void loadBezierVertices(Bezier *bez, Font *font)
+BEZIER_DEF void loadBezierVertices(Bezier *bez, Font *font, StreamBuffer *stream, Arena *scratch, RenderState *state)
 {
-    constexpr i32 VTX_SZ = 2 * sizeof(f32);
+    bez->dirtyProperties = (1u << ARRAY_COUNT(bez->vao)) - 1;
+    bez->dirtyPoints     = (1u << ARRAY_COUNT(bez->cp)) - 1;
 
-    { // control point lines
-    auto access  = i32(BezierProperty::Line);
-    auto bufSz   = bez->indexCount[access] * VTX_SZ;
-    auto cpLines = (f32*)malloc(bufSz);
-    defer(free(cpLines));
-
-    for (auto cp1 = 0; cp1 < ARRAY_COUNT(bez->cp) - 1; ++cp1) {
-        auto cp2 = cp1 + 1;
-        auto idx = cp1 * 4;
+    updateBezierVertices(bez, font, stream, scratch, state);
+}
 
-        cpLines[idx + 0] = bez->cp[cp1].x;
-        cpLines[idx + 1] = bez->cp[cp1].y;
-        cpLines[idx + 2] = bez->cp[cp2].x;
-        cpLines[idx + 3] = bez->cp[cp2].y;
+BEZIER_DEF void updateBezierVertices(Bezier *bez, Font *font, StreamBuffer *stream, Arena *scratch, RenderState *state)
+{
+    constexpr i32 VTX_SZ   = 2 * sizeof(f32);
+    constexpr i32 LAST_CP  = ARRAY_COUNT(bez->cp) - 1;
+    constexpr u32 LINE_BIT = 1u << i32(BezierProperty::Line);
+    constexpr u32 CURV_BIT = 1u << i32(BezierProperty::Curve);
+    constexpr u32 PNT_BIT  = 1u << i32(BezierProperty::Point);
+    constexpr u32 TEXT_BIT = 1u << i32(BezierProperty::Text);
+
+    auto dirty   = bez->dirtyProperties;
+    auto moved   = bez->dirtyPoints;
+    auto firstCp = i32(0);
+    auto lastCp  = i32(-1);
+
+    for (auto idx = 0; idx <= LAST_CP; ++idx) {
+        if (moved & (1u << idx)) {
+            if (lastCp < 0) firstCp = idx;
+            lastCp = idx;
+        }
+    }
+    if (dirty & (LINE_BIT | PNT_BIT)) {
+        firstCp = 0;
+        lastCp  = LAST_CP;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, bez->vbo[access]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, bufSz, (GLvoid*)cpLines);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    bez->dirtyProperties = 0;
+    bez->dirtyPoints     = 0;
+
+    if (lastCp >= 0) { // control point lines
+    auto access = i32(BezierProperty::Line);
+
+    // Control point n is the end of line n - 1 and the start of line n.
+    auto first   = firstCp > 0       ? 2 * firstCp - 1 : 0;
+    auto last    = lastCp  < LAST_CP ? 2 * lastCp      : 2 * LAST_CP - 1;
+    auto bufSz   = (last - first + 1) * VTX_SZ;
+    auto cpLines = (Vec2*) beginStreamWrite(stream, bez->vbo[access], first * VTX_SZ, bufSz);
+
+    // Line n goes from vertex 2n to 2n + 1.
+    for (auto vtx = first; vtx <= last; ++vtx)
+        cpLines[vtx - first] = bez->cp[(vtx + 1) / 2];
+
+    endStreamWrite(stream, state, bufSz);
     } // end control point lines
 
-    { // the actual bezier curve
+    if (!moved && !(dirty & CURV_BIT)) {
+        // The curve only changes with its control points or tessellation settings.
+    } else if (bez->tessellation == BezierTessellation::Gpu) {
+        // Vertex shader does the work, just draw one vertex per step.
+        bez->indexCount[i32(BezierProperty::Curve)] = GLsizei(bez->segments + 1);
+        bez->drawType[i32(BezierProperty::Curve)]   = GL_LINE_STRIP;
+    } else { // the actual bezier curve
+    constexpr u32 MAX_ADAPTIVE = (1 << BEZIER_ADAPTIVE_MAX_DEPTH) + 1;
+
     auto access   = i32(BezierProperty::Curve);
-    auto bufSz    = bez->indexCount[access] * VTX_SZ;
-    auto segments = (f32*)malloc(bufSz);
-    defer(free(segments));
-
-    segments[0]                     = bez->cp[0].x;
-    segments[1]                     = bez->cp[0].y;
-    segments[bez->segments * 2 + 0] = bez->cp[3].x;
-    segments[bez->segments * 2 + 1] = bez->cp[3].y;
-
-    for (u32 seg = 1; seg < bez->segments; ++seg) {
-        auto idx   = seg * 2;
-        auto scale = f32(seg) / f32(bez->segments);
-        auto c1    = bez->cp[0];
-        auto c2    = bez->cp[1];
-        auto c3    = bez->cp[2];
-        auto c4    = bez->cp[3];
-        auto pt    = bezier3(scale, c1, c2, c3, c4);
-
-        segments[idx + 0] = pt.x;
-        segments[idx + 1] = pt.y;
+    auto isAdapt  = bez->tessellation == BezierTessellation::Adaptive;
+    auto maxPts   = isAdapt ? MAX_ADAPTIVE : bez->segments + 1;
+    auto mark     = arenaMark(scratch);
+    auto segments = pushArray(scratch, Vec2, maxPts);
+    auto params   = pushArray(scratch, f32, bez->segments);
+    auto ptCnt    = bez->segments + 1;
+    defer(popArena(scratch, mark));
+
+    if (segments == nullptr || params == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough scratch memory to tessellate a bezier.\n");
+        exit(EXIT_FAILURE);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, bez->vbo[access]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, bufSz, (GLvoid*)segments);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    } // end bezier curve
+    auto isDone = false;
 
-    { // control points
-    auto access = i32(BezierProperty::Point);
-    auto bufSz  = bez->indexCount[access] * VTX_SZ;
-    auto cntPts = (f32*)malloc(bufSz);
-    defer(free(cntPts));
+    if (isAdapt) {
+        ptCnt  = adaptiveTessellate(bez, segments);
+        isDone = true;
+    } else if (bez->tessellation == BezierTessellation::ForwardDifference) {
+        isDone = forwardDifference(bez->cp, bez->segments, segments);
+    }
+
+    if (!isDone) {
+        segments[0]             = bez->cp[0];
+        segments[bez->segments] = bez->cp[3];
+
+        for (u32 seg = 1; seg < bez->segments; ++seg)
+            params[seg] = f32(seg) / f32(bez->segments);
+
+        if (bez->tessellation == BezierTessellation::ArcLength) {
+            updateBezierLengthTable(&bez->arcLength, bez->cp);
+
+            auto total = bezierLength(&bez->arcLength);
+
+            for (u32 seg = 1; seg < bez->segments; ++seg)
+                params[seg] *= total;
+            bezierLengthsToParams(&bez->arcLength, params + 1, bez->segments - 1, params + 1);
+        }
+
+        // Interior points only, the end points are exactly the end control points.
+        if (bez->segments > 1)
+            evalBezierParams(bez->cp, params + 1, bez->segments - 1, segments + 1);
+    }
+
+    auto vtxCnt = u32(0);
+
+    if (bez->curveStroke == BezierStroke::Distance) {
+        // Repeated end points mark the first and the last segment.
+        auto padded = (Vec2*) beginStreamWrite(stream, bez->vbo[access], 0, (ptCnt + 2) * VTX_SZ);
+
+        padded[0] = segments[0];
+        memcpy(padded + 1, segments, ptCnt * VTX_SZ);
+        padded[ptCnt + 1] = segments[ptCnt - 1];
+
+        vtxCnt = ptCnt + 2;
+        bez->indexCount[access] = GLsizei(ptCnt - 1);
+    } else {
+        // Width and arc tolerance are in pixels, the stroke is in world units.
+        auto scale = max_of(bez->screenScale, 1e-6f);
+        auto style = makeStrokeStyle(bez->lineWidth[access] / scale, bez->curveJoin, bez->curveCap);
 
-    for (auto cp = 0; cp < ARRAY_COUNT(bez->cp); ++cp) {
-        auto idx = cp * 2;
+        style.tolerance = bez->flatness / scale;
 
-        cntPts[idx + 0] = bez->cp[cp].x;
-        cntPts[idx + 1] = bez->cp[cp].y;
+        auto maxVtx = strokeVertexBound(ptCnt, style);
+        auto strip  = (Vec2*) beginStreamWrite(stream, bez->vbo[access], 0, maxVtx * VTX_SZ);
+
+        vtxCnt = strokePolyline(segments, ptCnt, style, strip);
+        bez->indexCount[access] = GLsizei(vtxCnt);
     }
 
+    auto bufSz = GLsizei(vtxCnt) * VTX_SZ;
+
+    bez->drawType[access] = GL_TRIANGLE_STRIP;
     glBindBuffer(GL_ARRAY_BUFFER, bez->vbo[access]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, bufSz, (GLvoid*)cntPts);
+    if (GLsizei(vtxCnt) > bez->vertexCapacity[access]) {
+        auto capacity = bez->vertexCapacity[access];
+
+        while (capacity < GLsizei(vtxCnt))
+            capacity *= 2;
+        bez->vertexCapacity[access] = capacity;
+        glBufferData(GL_ARRAY_BUFFER, capacity * VTX_SZ, nullptr, GL_DYNAMIC_DRAW);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    } // end control points
+    endStreamWrite(stream, state, bufSz);
+    } // end bezier curve
+
+    if (lastCp >= 0) { // control points
+    auto access = i32(BezierProperty::Point);
+    auto bufSz  = (lastCp - firstCp + 1) * VTX_SZ;
+    auto cntPts = (Vec2*) beginStreamWrite(stream, bez->vbo[access], firstCp * VTX_SZ, bufSz);
 
-    { // control point text
-    constexpr i32 TXT_BUF_SZ   = 20;
-    constexpr i32 VTX_PER_QUAD = 4;
-    constexpr i32 ACCESS       = i32(BezierProperty::Text);
+    for (auto cp = firstCp; cp <= lastCp; ++cp)
+        cntPts[cp - firstCp] = bez->cp[cp];
 
-    char txtBuf[TXT_BUF_SZ * ARRAY_COUNT(bez->cp)];
-    f32  text[TXT_BUF_SZ * VTX_PER_QUAD * 2 * 2]; // *2 for two f32 per vtx, * 2 for texture coordinates
+    endStreamWrite(stream, state, bufSz);
+    } // end control points
 
-    bez->indexCount[ACCESS] = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, bez->vbo[ACCESS]);
+    if (moved || (dirty & TEXT_BIT) || bez->labelFont != font) { // control point text
+    constexpr i32     TXT_BUF_SZ = BEZIER_LABEL_CHARS + 1;
+    constexpr i32     ACCESS     = i32(BezierProperty::Text);
+    constexpr GLsizei LABEL_SZ   = BEZIER_LABEL_CHARS * BEZIER_GLYPH_F32 * sizeof(f32);
 
-    auto offset = i32(0);
+    auto isRelayout = bez->labelFont != font || (dirty & TEXT_BIT);
+
+    bez->labelFont          = font;
+    bez->indexCount[ACCESS] = BEZIER_LABEL_CHARS * ARRAY_COUNT(bez->cp);
 
     for (auto idx = 0; idx < ARRAY_COUNT(bez->cp); ++idx) {
         constexpr f32 MAX_CP =  100000.0f;
         constexpr f32 MIN_CP = -100000.0f;
 
-        auto& cp = bez->cp[idx];
-        auto  x  = cp.x;
-        auto  y  = cp.y;
+        auto& cp    = bez->cp[idx];
+        auto& label = bez->labels[idx];
+
+        if (!isRelayout && !(moved & (1u << idx)))
+            continue;
+        if (!isRelayout && cp.x == label.anchor.x && cp.y == label.anchor.y)
+            continue;
+
+        auto x = cp.x;
+        auto y = cp.y;
         /*
          * Keep x and y in the interval of [-99999.9f, 99999.9f] to
          * limit the number of rendered text.
@@ -279,17 +668,37 @@ BEZIER_DEF void loadBezierVertices(Bezier *bez, Font *font)
         if (y > MAX_CP) y = MAX_CP - 0.1f;
         if (y < MIN_CP) y = MIN_CP + 0.1f;
 
-        auto cnt   = snprintf(txtBuf, TXT_BUF_SZ, "%.1f, %.1f", x, y);
-        auto bufSz = cnt * VTX_PER_QUAD * VTX_SZ * 2;
+        char txtBuf[TXT_BUF_SZ];
+        auto cnt = snprintf(txtBuf, TXT_BUF_SZ, "%.1f, %.1f", x, y);
+
+        label.anchor = cp;
+
+        if (!isRelayout && strcmp(txtBuf, label.text) == 0) {
+            // Same text at a slightly different spot, only the anchors move.
+            for (auto i = 0; label.text[i] != '\0'; ++i) {
+                label.glyphs[i * BEZIER_GLYPH_F32 + 0] = cp.x;
+                label.glyphs[i * BEZIER_GLYPH_F32 + 1] = cp.y;
+            }
+            auto glyphSz = u32(cnt * BEZIER_GLYPH_F32 * sizeof(f32));
+
+            memcpy(beginStreamWrite(stream, bez->vbo[ACCESS], idx * LABEL_SZ, glyphSz), label.glyphs, glyphSz);
+            endStreamWrite(stream, state, glyphSz);
+            continue;
+        }
+
         auto txt_x = 0.0f;
         auto txt_y = 0.0f;
         auto quad  = stbtt_aligned_quad{};
 
-        bez->textCharCount[idx]  = cnt;
-        bez->textIndexCount[idx] = cnt * VTX_PER_QUAD;
+        // Center the label above its control point.
+        auto nudge_x = cnt * font->pixelHeight * 0.25f;
+        auto nudge_y = font->pixelHeight + 10.0f;
+
+        memcpy(label.text, txtBuf, TXT_BUF_SZ);
+        memset(label.glyphs, 0, LABEL_SZ);
 
         for (auto i = 0; txtBuf[i] != '\0'; ++i) {
-            auto txtIdx = i * 16;
+            auto glyph = label.glyphs + i * BEZIER_GLYPH_F32;
 
             stbtt_GetBakedQuad(font->data, font->texDim, font->texDim,
                                txtBuf[i] - font->firstAsciiIndex,
@@ -297,92 +706,130 @@ BEZIER_DEF void loadBezierVertices(Bezier *bez, Font *font)
                                &quad,
                                true);
 
-            // top left
-            text[txtIdx + 0]  = quad.x0;
-            text[txtIdx + 1]  = -quad.y0;
-            text[txtIdx + 2]  = quad.s0;
-            text[txtIdx + 3]  = quad.t0;
-            // top right
-            text[txtIdx + 4]  = quad.x1;
-            text[txtIdx + 5]  = -quad.y0;
-            text[txtIdx + 6]  = quad.s1;
-            text[txtIdx + 7]  = quad.t0;
-            // bottom right
-            text[txtIdx + 8]  = quad.x1;
-            text[txtIdx + 9]  = -quad.y1;
-            text[txtIdx + 10] = quad.s1;
-            text[txtIdx + 11] = quad.t1;
-            // bottom left
-            text[txtIdx + 12] = quad.x0;
-            text[txtIdx + 13] = -quad.y1;
-            text[txtIdx + 14] = quad.s0;
-            text[txtIdx + 15] = quad.t1;
+            // anchor
+            glyph[0] = cp.x;
+            glyph[1] = cp.y;
+            // top left and bottom right corners
+            glyph[2] = quad.x0 - nudge_x;
+            glyph[3] = -quad.y0 - nudge_y;
+            glyph[4] = quad.x1 - nudge_x;
+            glyph[5] = -quad.y1 - nudge_y;
+            // atlas rectangle
+            glyph[6] = quad.s0;
+            glyph[7] = quad.t0;
+            glyph[8] = quad.s1;
+            glyph[9] = quad.t1;
         }
 
-        glBufferSubData(GL_ARRAY_BUFFER, offset, bufSz, (GLvoid*) text);
-        offset += bufSz;
+        // The whole slot so glyphs left over from a longer label are cleared.
+        memcpy(beginStreamWrite(stream, bez->vbo[ACCESS], idx * LABEL_SZ, LABEL_SZ), label.glyphs, LABEL_SZ);
+        endStreamWrite(stream, state, LABEL_SZ);
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     } // control point text
 }
 
-BEZIER_DEF void
+/*
+ * The curve stays inside its control polygon, so the control points' box
+ * covers everything but the labels, which reach at most a label's length
+ * of glyphs (in pixels) to the right of and above their anchor.
+ */
+static bool isBezierVisible(Bezier const* bezier, Font const* font, Mat4 const* lineMVP, Mat4 const* textMVP)
+{
+    auto lo = vec2( INFINITY,  INFINITY);
+    auto hi = vec2(-INFINITY, -INFINITY);
+
+    for (auto idx = 0; idx < ARRAY_COUNT(bezier->cp); ++idx) {
+        auto clip = *lineMVP * vec4(bezier->cp[idx].x, bezier->cp[idx].y, 0.0f, 1.0f);
+
+        lo = min_of(lo, vec2(clip.x, clip.y));
+        hi = max_of(hi, vec2(clip.x, clip.y));
+    }
+
+    auto reach  = BEZIER_LABEL_CHARS * font->pixelHeight;
+    auto margin = vec2(fabsf(textMVP->at(0, 0)), fabsf(textMVP->at(1, 1))) * reach;
+
+    return lo.x - margin.x <= 1.0f && hi.x + margin.x >= -1.0f
+        && lo.y - margin.y <= 1.0f && hi.y + margin.y >= -1.0f;
+}
+
+BEZIER_DEF bool
 renderBezier(Bezier*       bezier,
              BezierShader* shader,
+             RenderState*  state,
              Font*         font,
              Mat4*         lineMVP,
-             Mat4*         textMVP)
+             Mat4*         textMVP,
+             Vec2          viewport)
 {
-    GLfloat lineWidth, pointSize;
-    glGetFloatv(GL_LINE_WIDTH, &lineWidth);
-    glGetFloatv(GL_POINT_SIZE, &pointSize);
-    glEnable(GL_LINE_SMOOTH);
-    glUseProgram(shader->lineProgramId);
+    if (!isBezierVisible(bezier, font, lineMVP, textMVP))
+        return false;
+
+    setCapability(state, GL_LINE_SMOOTH, true);
+    setProgram(state, shader->lineProgramId);
     glUniformMatrix4fv(shader->lineMVP_uniform, 1, GL_FALSE, lineMVP->data);
 
     for (auto idx = 0; idx < ARRAY_COUNT(bezier->vao) - 1; ++idx) {
-        auto& lineColor = bezier->colors[idx];
-        glLineWidth(bezier->lineWidth[idx]);
-        glPointSize(bezier->lineWidth[idx]);
-        glUniform4f(shader->lineColor_uniform, lineColor.r, lineColor.g, lineColor.b, lineColor.a);
-        glBindVertexArray(bezier->vao[idx]);
+        auto& lineColor  = bezier->colors[idx];
+        auto  isCurve    = idx == i32(BezierProperty::Curve);
+        auto  isGpu      = isCurve && bezier->tessellation == BezierTessellation::Gpu;
+        auto  isDistance = isCurve && !isGpu && bezier->curveStroke == BezierStroke::Distance;
+        auto  isStroke   = isCurve && !isGpu && !isDistance;
+        auto  wasCulling = isCapabilityEnabled(state, GL_CULL_FACE);
+
+        if (isDistance) {
+            // Covered by distance, four strip vertices per segment instance.
+            setProgram(state, shader->strokeProgramId);
+            glUniformMatrix4fv(shader->strokeMVP_uniform, 1, GL_FALSE, lineMVP->data);
+            glUniform2f(shader->strokeViewport_uniform, viewport.x, viewport.y);
+            glUniform1f(shader->strokeWidth_uniform, bezier->lineWidth[idx]);
+            glUniform1i(shader->strokeCap_uniform, GLint(bezier->curveCap));
+            glUniform4f(shader->strokeColor_uniform, lineColor.r, lineColor.g, lineColor.b, lineColor.a);
+            setVertexArray(state, bezier->strokeVao);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, bezier->indexCount[idx]);
+            continue;
+        }
+
+        setLineWidth(state, bezier->lineWidth[idx]);
+        setPointSize(state, bezier->lineWidth[idx]);
+        if (isGpu) {
+            setProgram(state, shader->curveProgramId);
+            glUniformMatrix4fv(shader->curveMVP_uniform, 1, GL_FALSE, lineMVP->data);
+            glUniform2fv(shader->curveControlPoints_uniform, 4, bezier->cp[0].data);
+            glUniform1i(shader->curveSegments_uniform, GLint(bezier->segments));
+            glUniform4f(shader->curveColor_uniform, lineColor.r, lineColor.g, lineColor.b, lineColor.a);
+        } else {
+            setProgram(state, shader->lineProgramId);
+            glUniform4f(shader->lineColor_uniform, lineColor.r, lineColor.g, lineColor.b, lineColor.a);
+        }
+        // Joins turn the strip around, so its triangles face both ways.
+        if (isStroke)
+            setCapability(state, GL_CULL_FACE, false);
+        setVertexArray(state, bezier->vao[idx]);
         glDrawArrays(bezier->drawType[idx], 0, bezier->indexCount[idx]);
+        if (isStroke)
+            setCapability(state, GL_CULL_FACE, wasCulling);
     }
-    glLineWidth(lineWidth);
-    glPointSize(pointSize);
-    glDisable(GL_LINE_SMOOTH);
 
     constexpr i32 TEXT = i32(BezierProperty::Text);
 
-    glUseProgram(shader->textProgramId);
+    setProgram(state, shader->textProgramId);
     glUniform1i(shader->textTexture_uniform, 0);
     glUniformMatrix4fv(shader->textMVP_uniform, 1, GL_FALSE, textMVP->data);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, font->texId);
+    glUniformMatrix4fv(shader->textLineMVP_uniform, 1, GL_FALSE, lineMVP->data);
+    setActiveTexture(state, GL_TEXTURE0);
+    setTexture2D(state, font->texId);
     glUniform4f(shader->textColor_uniform,
                 bezier->colors[TEXT].r,
                 bezier->colors[TEXT].g,
                 bezier->colors[TEXT].b,
                 bezier->colors[TEXT].a);
 
-    for (i32 idx = 0, idxOffset = 0; idx < ARRAY_COUNT(bezier->cp); ++idx) {
-        auto& cp       = bezier->cp[idx];
-        auto  chCnt    = bezier->textCharCount[idx];
-        auto  txt_x    = chCnt * font->pixelHeight * 0.25f;
-        auto  txt_y    = font->pixelHeight + 10.0f;
-        auto  txtNudge = vec4(txt_x, txt_y, 0.0f, 1.0f);
-        auto  offset   = vec4(cp.x, cp.y, 0.0f, 1.0f);
-
-        txtNudge = (*textMVP) * txtNudge;
-        offset   = (*lineMVP) * offset;
-        offset   = offset - txtNudge;
-
-        glUniform4f(shader->textOffset_uniform, offset.x, offset.y, offset.z, offset.w);
-        glBindVertexArray(bezier->vao[TEXT]);
-        glDrawArrays(GL_QUADS, idxOffset, bezier->textIndexCount[idx]);
-        idxOffset += bezier->textIndexCount[idx];
-    }
-    glBindVertexArray(0);
+    // Every label in one draw, four strip vertices per glyph instance.
+    setVertexArray(state, bezier->vao[TEXT]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, bezier->indexCount[TEXT]);
+    setVertexArray(state, 0);
+
+    return true;
 }
 
 #endif // BEZIER_IMPLEMENTATION
@@ -0,0 +1,455 @@
+#ifndef GUARD_INCLUDE_BEZIER_BATCH_H
+#define GUARD_INCLUDE_BEZIER_BATCH_H
+
+#ifdef BEZIER_BATCH_STATIC
+    #define BEZIER_BATCH_DEF static
+#else
+    #define BEZIER_BATCH_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier_n.h"
+
+/*
+ * Control points for many cubic bezier curves in structure-of-arrays
+ * layout.  x[i][n] and y[i][n] are the coordinates of control point i
+ * for curve n, where each of the eight arrays holds count elements.
+ */
+struct BezierSoA {
+    f32 *x[4];
+    f32 *y[4];
+    u32  count;
+};
+
+/*
+ * Rational cubics in the same layout.  x and y hold the weighted
+ * coordinates of the homogeneous form (see RationalBezierN in
+ * bezier_n.h) and w the weights.  Rational quadratics and conic arcs go
+ * in through elevateBezier, which is exact for the homogeneous form.
+ */
+struct RationalBezierSoA {
+    f32 *x[4];
+    f32 *y[4];
+    f32 *w[4];
+    u32  count;
+};
+
+enum class BezierSimd : i32 {
+    Scalar = 0,
+    SSE    = 1,     // 4 lanes
+    AVX2   = 2,     // 8 lanes
+};
+
+/*
+ * The batch evaluators perform the same de Casteljau steps, in the same
+ * order, as evalBezierN in bezier_n.h so the results are bit for
+ * bit identical on every dispatch level as long as the compiler doesn't
+ * contract the multiply and add into a fused multiply-add (MSVC's
+ * default /fp:precise doesn't).  With contraction enabled the results
+ * differ by at most a couple of ulps, well under 1e-5 relative to the
+ * magnitude of the control points.
+ */
+
+/*
+ * Returns the widest instruction set the batch evaluators dispatch to.
+ * This is the best level supported by the CPU unless it was lowered with
+ * setBezierSimdLevel.
+ */
+BEZIER_BATCH_DEF BezierSimd bezierSimdLevel();
+
+/*
+ * Force the batch evaluators to use at most level.  Requests above what
+ * the CPU supports are clamped.  Mostly useful for comparing paths.
+ */
+BEZIER_BATCH_DEF void setBezierSimdLevel(BezierSimd level);
+
+/*
+ * Evaluate curve n of curves at parameter t[n] for every curve, writing
+ * the result to outX[n] and outY[n].
+ */
+BEZIER_BATCH_DEF void evalBezierCurves(BezierSoA const *curves, f32 const *t, f32 *outX, f32 *outY);
+
+/*
+ * Evaluate the single curve defined by cp at count parameters in t,
+ * writing the points to out.
+ */
+BEZIER_BATCH_DEF void evalBezierParams(Vec2 const *cp, f32 const *t, u32 count, Vec2 *out);
+
+/*
+ * The rational versions of the two above.  Each coordinate of the
+ * homogeneous form is evaluated like a plain cubic and x and y divided
+ * by w, so the results match evalRationalBezier bit for bit.
+ */
+BEZIER_BATCH_DEF void evalRationalBezierCurves(RationalBezierSoA const *curves, f32 const *t, f32 *outX, f32 *outY);
+BEZIER_BATCH_DEF void evalRationalBezierParams(Vec3 const *cp, f32 const *t, u32 count, Vec2 *out);
+
+#endif // GUARD_INCLUDE_BEZIER_BATCH_H
+
+
+#ifdef BEZIER_BATCH_IMPLEMENTATION
+
+#include <SDL_cpuinfo.h>
+
+#if !defined(BEZIER_BATCH_NO_SIMD) && (defined(_M_X64) || defined(__x86_64__))
+    #define BEZIER_BATCH_X64 1
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #define BEZIER_BATCH_TARGET_AVX2
+    #else
+        #define BEZIER_BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define BEZIER_BATCH_X64 0
+#endif
+
+typedef void (*BezierCurvesFn)(BezierSoA const*, f32 const*, f32*, f32*, u32, u32);
+typedef void (*BezierParamsFn)(Vec2 const*, f32 const*, Vec2*, u32, u32);
+typedef void (*RationalCurvesFn)(RationalBezierSoA const*, f32 const*, f32*, f32*, u32, u32);
+typedef void (*RationalParamsFn)(Vec3 const*, f32 const*, Vec2*, u32, u32);
+
+struct BezierBatchDispatch {
+    bool             isInitialized;
+    BezierSimd       maxLevel;  // what the CPU supports
+    BezierSimd       level;     // what is currently used
+    BezierCurvesFn   curves;
+    BezierParamsFn   params;
+    RationalCurvesFn rationalCurves;
+    RationalParamsFn rationalParams;
+};
+
+static BezierBatchDispatch bezierBatch = {};
+
+/*
+ * One coordinate of cubic de Casteljau, the SIMD paths below repeat its
+ * steps lane by lane.
+ */
+static inline f32 bezierBatchEval(f32 t, f32 p0, f32 p1, f32 p2, f32 p3)
+{
+    return evalBezierN(BezierN<3, f32>{ { p0, p1, p2, p3 } }, t);
+}
+
+static void
+bezierCurvesScalar(BezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    for (auto n = start; n < end; ++n) {
+        outX[n] = bezierBatchEval(t[n], bz->x[0][n], bz->x[1][n], bz->x[2][n], bz->x[3][n]);
+        outY[n] = bezierBatchEval(t[n], bz->y[0][n], bz->y[1][n], bz->y[2][n], bz->y[3][n]);
+    }
+}
+
+static void
+bezierParamsScalar(Vec2 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    for (auto n = start; n < end; ++n) {
+        out[n].x = bezierBatchEval(t[n], cp[0].x, cp[1].x, cp[2].x, cp[3].x);
+        out[n].y = bezierBatchEval(t[n], cp[0].y, cp[1].y, cp[2].y, cp[3].y);
+    }
+}
+
+static void
+rationalCurvesScalar(RationalBezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    for (auto n = start; n < end; ++n) {
+        auto w = bezierBatchEval(t[n], bz->w[0][n], bz->w[1][n], bz->w[2][n], bz->w[3][n]);
+
+        outX[n] = bezierBatchEval(t[n], bz->x[0][n], bz->x[1][n], bz->x[2][n], bz->x[3][n]) / w;
+        outY[n] = bezierBatchEval(t[n], bz->y[0][n], bz->y[1][n], bz->y[2][n], bz->y[3][n]) / w;
+    }
+}
+
+static void
+rationalParamsScalar(Vec3 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    for (auto n = start; n < end; ++n) {
+        auto w = bezierBatchEval(t[n], cp[0].z, cp[1].z, cp[2].z, cp[3].z);
+
+        out[n].x = bezierBatchEval(t[n], cp[0].x, cp[1].x, cp[2].x, cp[3].x) / w;
+        out[n].y = bezierBatchEval(t[n], cp[0].y, cp[1].y, cp[2].y, cp[3].y) / w;
+    }
+}
+
+#if BEZIER_BATCH_X64
+
+static inline __m128 bezierEvalSSE(__m128 t, __m128 p0, __m128 p1, __m128 p2, __m128 p3)
+{
+    auto u = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+    auto a = _mm_add_ps(_mm_mul_ps(u, p0), _mm_mul_ps(t, p1));
+    auto b = _mm_add_ps(_mm_mul_ps(u, p1), _mm_mul_ps(t, p2));
+    auto c = _mm_add_ps(_mm_mul_ps(u, p2), _mm_mul_ps(t, p3));
+    auto d = _mm_add_ps(_mm_mul_ps(u, a),  _mm_mul_ps(t, b));
+    auto e = _mm_add_ps(_mm_mul_ps(u, b),  _mm_mul_ps(t, c));
+
+    return _mm_add_ps(_mm_mul_ps(u, d), _mm_mul_ps(t, e));
+}
+
+static void
+bezierCurvesSSE(BezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    auto n = start;
+
+    for (; n + 4 <= end; n += 4) {
+        auto tt = _mm_loadu_ps(t + n);
+        auto x  = bezierEvalSSE(tt,
+                                _mm_loadu_ps(bz->x[0] + n), _mm_loadu_ps(bz->x[1] + n),
+                                _mm_loadu_ps(bz->x[2] + n), _mm_loadu_ps(bz->x[3] + n));
+        auto y  = bezierEvalSSE(tt,
+                                _mm_loadu_ps(bz->y[0] + n), _mm_loadu_ps(bz->y[1] + n),
+                                _mm_loadu_ps(bz->y[2] + n), _mm_loadu_ps(bz->y[3] + n));
+
+        _mm_storeu_ps(outX + n, x);
+        _mm_storeu_ps(outY + n, y);
+    }
+    bezierCurvesScalar(bz, t, outX, outY, n, end);
+}
+
+static void
+bezierParamsSSE(Vec2 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    auto x0 = _mm_set1_ps(cp[0].x), y0 = _mm_set1_ps(cp[0].y);
+    auto x1 = _mm_set1_ps(cp[1].x), y1 = _mm_set1_ps(cp[1].y);
+    auto x2 = _mm_set1_ps(cp[2].x), y2 = _mm_set1_ps(cp[2].y);
+    auto x3 = _mm_set1_ps(cp[3].x), y3 = _mm_set1_ps(cp[3].y);
+    auto n  = start;
+
+    for (; n + 4 <= end; n += 4) {
+        auto tt  = _mm_loadu_ps(t + n);
+        auto x   = bezierEvalSSE(tt, x0, x1, x2, x3);
+        auto y   = bezierEvalSSE(tt, y0, y1, y2, y3);
+        auto dst = (f32*)(out + n);
+
+        _mm_storeu_ps(dst + 0, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(x, y));
+    }
+    bezierParamsScalar(cp, t, out, n, end);
+}
+
+static void
+rationalCurvesSSE(RationalBezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    auto n = start;
+
+    for (; n + 4 <= end; n += 4) {
+        auto tt = _mm_loadu_ps(t + n);
+        auto w  = bezierEvalSSE(tt,
+                                _mm_loadu_ps(bz->w[0] + n), _mm_loadu_ps(bz->w[1] + n),
+                                _mm_loadu_ps(bz->w[2] + n), _mm_loadu_ps(bz->w[3] + n));
+        auto x  = bezierEvalSSE(tt,
+                                _mm_loadu_ps(bz->x[0] + n), _mm_loadu_ps(bz->x[1] + n),
+                                _mm_loadu_ps(bz->x[2] + n), _mm_loadu_ps(bz->x[3] + n));
+        auto y  = bezierEvalSSE(tt,
+                                _mm_loadu_ps(bz->y[0] + n), _mm_loadu_ps(bz->y[1] + n),
+                                _mm_loadu_ps(bz->y[2] + n), _mm_loadu_ps(bz->y[3] + n));
+
+        _mm_storeu_ps(outX + n, _mm_div_ps(x, w));
+        _mm_storeu_ps(outY + n, _mm_div_ps(y, w));
+    }
+    rationalCurvesScalar(bz, t, outX, outY, n, end);
+}
+
+static void
+rationalParamsSSE(Vec3 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    auto x0 = _mm_set1_ps(cp[0].x), y0 = _mm_set1_ps(cp[0].y), w0 = _mm_set1_ps(cp[0].z);
+    auto x1 = _mm_set1_ps(cp[1].x), y1 = _mm_set1_ps(cp[1].y), w1 = _mm_set1_ps(cp[1].z);
+    auto x2 = _mm_set1_ps(cp[2].x), y2 = _mm_set1_ps(cp[2].y), w2 = _mm_set1_ps(cp[2].z);
+    auto x3 = _mm_set1_ps(cp[3].x), y3 = _mm_set1_ps(cp[3].y), w3 = _mm_set1_ps(cp[3].z);
+    auto n  = start;
+
+    for (; n + 4 <= end; n += 4) {
+        auto tt  = _mm_loadu_ps(t + n);
+        auto w   = bezierEvalSSE(tt, w0, w1, w2, w3);
+        auto x   = _mm_div_ps(bezierEvalSSE(tt, x0, x1, x2, x3), w);
+        auto y   = _mm_div_ps(bezierEvalSSE(tt, y0, y1, y2, y3), w);
+        auto dst = (f32*)(out + n);
+
+        _mm_storeu_ps(dst + 0, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(x, y));
+    }
+    rationalParamsScalar(cp, t, out, n, end);
+}
+
+BEZIER_BATCH_TARGET_AVX2 static inline __m256
+bezierEvalAVX2(__m256 t, __m256 p0, __m256 p1, __m256 p2, __m256 p3)
+{
+    auto u = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+    auto a = _mm256_add_ps(_mm256_mul_ps(u, p0), _mm256_mul_ps(t, p1));
+    auto b = _mm256_add_ps(_mm256_mul_ps(u, p1), _mm256_mul_ps(t, p2));
+    auto c = _mm256_add_ps(_mm256_mul_ps(u, p2), _mm256_mul_ps(t, p3));
+    auto d = _mm256_add_ps(_mm256_mul_ps(u, a),  _mm256_mul_ps(t, b));
+    auto e = _mm256_add_ps(_mm256_mul_ps(u, b),  _mm256_mul_ps(t, c));
+
+    return _mm256_add_ps(_mm256_mul_ps(u, d), _mm256_mul_ps(t, e));
+}
+
+BEZIER_BATCH_TARGET_AVX2 static void
+bezierCurvesAVX2(BezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    auto n = start;
+
+    for (; n + 8 <= end; n += 8) {
+        auto tt = _mm256_loadu_ps(t + n);
+        auto x  = bezierEvalAVX2(tt,
+                                 _mm256_loadu_ps(bz->x[0] + n), _mm256_loadu_ps(bz->x[1] + n),
+                                 _mm256_loadu_ps(bz->x[2] + n), _mm256_loadu_ps(bz->x[3] + n));
+        auto y  = bezierEvalAVX2(tt,
+                                 _mm256_loadu_ps(bz->y[0] + n), _mm256_loadu_ps(bz->y[1] + n),
+                                 _mm256_loadu_ps(bz->y[2] + n), _mm256_loadu_ps(bz->y[3] + n));
+
+        _mm256_storeu_ps(outX + n, x);
+        _mm256_storeu_ps(outY + n, y);
+    }
+    bezierCurvesSSE(bz, t, outX, outY, n, end);
+}
+
+BEZIER_BATCH_TARGET_AVX2 static void
+bezierParamsAVX2(Vec2 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    auto x0 = _mm256_set1_ps(cp[0].x), y0 = _mm256_set1_ps(cp[0].y);
+    auto x1 = _mm256_set1_ps(cp[1].x), y1 = _mm256_set1_ps(cp[1].y);
+    auto x2 = _mm256_set1_ps(cp[2].x), y2 = _mm256_set1_ps(cp[2].y);
+    auto x3 = _mm256_set1_ps(cp[3].x), y3 = _mm256_set1_ps(cp[3].y);
+    auto n  = start;
+
+    for (; n + 8 <= end; n += 8) {
+        auto tt  = _mm256_loadu_ps(t + n);
+        auto x   = bezierEvalAVX2(tt, x0, x1, x2, x3);
+        auto y   = bezierEvalAVX2(tt, y0, y1, y2, y3);
+        auto lo  = _mm256_unpacklo_ps(x, y);   // x0 y0 x1 y1 | x4 y4 x5 y5
+        auto hi  = _mm256_unpackhi_ps(x, y);   // x2 y2 x3 y3 | x6 y6 x7 y7
+        auto dst = (f32*)(out + n);
+
+        _mm256_storeu_ps(dst + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    bezierParamsSSE(cp, t, out, n, end);
+}
+
+BEZIER_BATCH_TARGET_AVX2 static void
+rationalCurvesAVX2(RationalBezierSoA const *bz, f32 const *t, f32 *outX, f32 *outY, u32 start, u32 end)
+{
+    auto n = start;
+
+    for (; n + 8 <= end; n += 8) {
+        auto tt = _mm256_loadu_ps(t + n);
+        auto w  = bezierEvalAVX2(tt,
+                                 _mm256_loadu_ps(bz->w[0] + n), _mm256_loadu_ps(bz->w[1] + n),
+                                 _mm256_loadu_ps(bz->w[2] + n), _mm256_loadu_ps(bz->w[3] + n));
+        auto x  = bezierEvalAVX2(tt,
+                                 _mm256_loadu_ps(bz->x[0] + n), _mm256_loadu_ps(bz->x[1] + n),
+                                 _mm256_loadu_ps(bz->x[2] + n), _mm256_loadu_ps(bz->x[3] + n));
+        auto y  = bezierEvalAVX2(tt,
+                                 _mm256_loadu_ps(bz->y[0] + n), _mm256_loadu_ps(bz->y[1] + n),
+                                 _mm256_loadu_ps(bz->y[2] + n), _mm256_loadu_ps(bz->y[3] + n));
+
+        _mm256_storeu_ps(outX + n, _mm256_div_ps(x, w));
+        _mm256_storeu_ps(outY + n, _mm256_div_ps(y, w));
+    }
+    rationalCurvesSSE(bz, t, outX, outY, n, end);
+}
+
+BEZIER_BATCH_TARGET_AVX2 static void
+rationalParamsAVX2(Vec3 const *cp, f32 const *t, Vec2 *out, u32 start, u32 end)
+{
+    auto x0 = _mm256_set1_ps(cp[0].x), y0 = _mm256_set1_ps(cp[0].y), w0 = _mm256_set1_ps(cp[0].z);
+    auto x1 = _mm256_set1_ps(cp[1].x), y1 = _mm256_set1_ps(cp[1].y), w1 = _mm256_set1_ps(cp[1].z);
+    auto x2 = _mm256_set1_ps(cp[2].x), y2 = _mm256_set1_ps(cp[2].y), w2 = _mm256_set1_ps(cp[2].z);
+    auto x3 = _mm256_set1_ps(cp[3].x), y3 = _mm256_set1_ps(cp[3].y), w3 = _mm256_set1_ps(cp[3].z);
+    auto n  = start;
+
+    for (; n + 8 <= end; n += 8) {
+        auto tt  = _mm256_loadu_ps(t + n);
+        auto w   = bezierEvalAVX2(tt, w0, w1, w2, w3);
+        auto x   = _mm256_div_ps(bezierEvalAVX2(tt, x0, x1, x2, x3), w);
+        auto y   = _mm256_div_ps(bezierEvalAVX2(tt, y0, y1, y2, y3), w);
+        auto lo  = _mm256_unpacklo_ps(x, y);
+        auto hi  = _mm256_unpackhi_ps(x, y);
+        auto dst = (f32*)(out + n);
+
+        _mm256_storeu_ps(dst + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    rationalParamsSSE(cp, t, out, n, end);
+}
+
+#endif // BEZIER_BATCH_X64
+
+static void selectBezierBatchFns(BezierSimd level)
+{
+    if (level > bezierBatch.maxLevel)
+        level = bezierBatch.maxLevel;
+
+    bezierBatch.level          = level;
+    bezierBatch.curves         = bezierCurvesScalar;
+    bezierBatch.params         = bezierParamsScalar;
+    bezierBatch.rationalCurves = rationalCurvesScalar;
+    bezierBatch.rationalParams = rationalParamsScalar;
+
+#if BEZIER_BATCH_X64
+    if (level == BezierSimd::AVX2) {
+        bezierBatch.curves         = bezierCurvesAVX2;
+        bezierBatch.params         = bezierParamsAVX2;
+        bezierBatch.rationalCurves = rationalCurvesAVX2;
+        bezierBatch.rationalParams = rationalParamsAVX2;
+    } else if (level == BezierSimd::SSE) {
+        bezierBatch.curves         = bezierCurvesSSE;
+        bezierBatch.params         = bezierParamsSSE;
+        bezierBatch.rationalCurves = rationalCurvesSSE;
+        bezierBatch.rationalParams = rationalParamsSSE;
+    }
+#endif
+}
+
+static void initBezierBatch()
+{
+    if (bezierBatch.isInitialized)
+        return;
+
+    bezierBatch.maxLevel = BezierSimd::Scalar;
+#if BEZIER_BATCH_X64
+    // SSE2 is part of the x64 baseline.
+    bezierBatch.maxLevel = SDL_HasAVX2() ? BezierSimd::AVX2 : BezierSimd::SSE;
+#endif
+    bezierBatch.isInitialized = true;
+    selectBezierBatchFns(bezierBatch.maxLevel);
+}
+
+BEZIER_BATCH_DEF BezierSimd bezierSimdLevel()
+{
+    initBezierBatch();
+    return bezierBatch.level;
+}
+
+BEZIER_BATCH_DEF void setBezierSimdLevel(BezierSimd level)
+{
+    initBezierBatch();
+    selectBezierBatchFns(level);
+}
+
+BEZIER_BATCH_DEF void evalBezierCurves(BezierSoA const *curves, f32 const *t, f32 *outX, f32 *outY)
+{
+    initBezierBatch();
+    bezierBatch.curves(curves, t, outX, outY, 0, curves->count);
+}
+
+BEZIER_BATCH_DEF void evalBezierParams(Vec2 const *cp, f32 const *t, u32 count, Vec2 *out)
+{
+    initBezierBatch();
+    bezierBatch.params(cp, t, out, 0, count);
+}
+
+BEZIER_BATCH_DEF void
+evalRationalBezierCurves(RationalBezierSoA const *curves, f32 const *t, f32 *outX, f32 *outY)
+{
+    initBezierBatch();
+    bezierBatch.rationalCurves(curves, t, outX, outY, 0, curves->count);
+}
+
+BEZIER_BATCH_DEF void evalRationalBezierParams(Vec3 const *cp, f32 const *t, u32 count, Vec2 *out)
+{
+    initBezierBatch();
+    bezierBatch.rationalParams(cp, t, out, 0, count);
+}
+
+#endif // BEZIER_BATCH_IMPLEMENTATION
@@ -0,0 +1,516 @@
+#ifndef GUARD_INCLUDE_BEZIER_FILL_H
+#define GUARD_INCLUDE_BEZIER_FILL_H
+
+#ifdef BEZIER_FILL_STATIC
+    #define BEZIER_FILL_DEF static
+#else
+    #define BEZIER_FILL_DEF extern
+#endif
+
+#include <glad/glad.h>
+
+#include "m3d.h"
+#include "common.h"
+#include "render_state.h"
+#include "stream_buffer.h"
+#include "bezier_n.h"
+
+/*
+ * Klm are the implicit form coordinates of Loop and Blinn, "Resolution
+ * Independent Curve Rendering using Programmable Graphics Hardware".  A
+ * fragment is on the filled side of its curve where k^3 - l*m < 0.
+ */
+struct BezierFillVertex {
+    Vec2 pos;
+    Vec3 klm;
+};
+
+/*
+ * A closed outline of cubics filled with the even-odd rule.  Every curve
+ * is split at its inflections and loop double point, the control hull of
+ * every piece is drawn with the piece's klm and a fan over the piece end
+ * points closes the outline.  Each of them flips the stencil, so the
+ * triangles never have to be sorted into inside and outside.  A box
+ * around the outline then covers what was flipped an odd number of times.
+ *
+ * The triangles only change with the control points, the edges are
+ * exact at any zoom.
+ */
+struct BezierFill {
+    GLuint  vao;
+    GLuint  vbo;
+    GLsizei vertexCount;    // stencil triangles, the cover box follows
+    GLsizei gpuCapacity;
+};
+
+struct BezierFillShader {
+    GLuint programId;
+    GLuint MVP_uniform;
+    GLuint color_uniform;
+};
+
+constexpr u32 BEZIER_FILL_COVER_VERTICES = 6;
+
+BEZIER_FILL_DEF BezierFill makeBezierFill(u32 curveCount);
+BEZIER_FILL_DEF void       freeBezierFill(BezierFill *fill);
+
+/*
+ * Most vertices triangulateBezierFill writes for curveCount curves,
+ * including the cover box.
+ */
+BEZIER_FILL_DEF u32 bezierFillVertexBound(u32 curveCount);
+
+/*
+ * Write the stencil triangles of the outline cp to out, followed by the
+ * cover box, and return the number of stencil vertices.  cp holds
+ * 3 * curveCount + 1 points, curve n is cp[3n] to cp[3n + 3].  If the
+ * last point isn't the first the outline is closed with a line.
+ */
+BEZIER_FILL_DEF u32 triangulateBezierFill(Vec2 const *cp, u32 curveCount, BezierFillVertex *out);
+
+/*
+ * Triangulate the outline cp and upload it.  Call again when cp changes.
+ */
+BEZIER_FILL_DEF void loadBezierFill(BezierFill *fill, Vec2 const *cp, u32 curveCount, StreamBuffer *stream, RenderState *state);
+
+/*
+ * Fill in two passes over the stencil buffer, which has to be zero
+ * where the outline is, and is left zero.
+ */
+BEZIER_FILL_DEF void renderBezierFill(BezierFill       *fill,
+                                      BezierFillShader *shader,
+                                      RenderState      *state,
+                                      Mat4             *mvp,
+                                      Vec4              color);
+
+#endif // GUARD_INCLUDE_BEZIER_FILL_H
+
+
+#ifdef BEZIER_FILL_IMPLEMENTATION
+
+#include <stddef.h>
+#include <math.h>
+#include <SDL_log.h>
+
+/* Most pieces a curve is split into, at two inflections or two double point parameters. */
+constexpr u32 BEZIER_FILL_MAX_PIECES = 3;
+/* Two triangles of hull and one of fan per piece. */
+constexpr u32 BEZIER_FILL_PIECE_VERTICES = 9;
+
+enum class CubicType : i32 {
+    Line,               // no area between the curve and its chord
+    Quadratic,
+    Serpentine,         // also a cusp with an inflection
+    Loop,
+    CuspAtInfinity,
+};
+
+/*
+ * The curve's type and the linear factors its klm are made of, in the
+ * notation of Loop and Blinn the factor L(t) = ls - lt * t.
+ */
+struct CubicForm {
+    CubicType type;
+    f32       ls, lt;
+    f32       ms, mt;
+};
+
+static f32 det3(Vec3 a, Vec3 b, Vec3 c)
+{
+    return a.x * (b.y * c.z - b.z * c.y)
+         - a.y * (b.x * c.z - b.z * c.x)
+         + a.z * (b.x * c.y - b.y * c.x);
+}
+
+static CubicForm classifyCubic(Vec2 const *cp)
+{
+    constexpr f32 EPSILON = 1e-5f;
+
+    // The determinants only scale under moving and scaling the curve, so
+    // do that first to keep them in range.
+    auto lo = min_of(min_of(cp[0], cp[1]), min_of(cp[2], cp[3]));
+    auto hi = max_of(max_of(cp[0], cp[1]), max_of(cp[2], cp[3]));
+    auto sz = max_of(hi.x - lo.x, hi.y - lo.y);
+    auto form = CubicForm{};
+
+    if (sz <= 0.0f)
+        return form;
+
+    Vec3 b[4];
+
+    for (auto idx = 0; idx < 4; ++idx) {
+        auto pt = (cp[idx] - lo) / sz;
+
+        b[idx] = vec3(pt.x, pt.y, 1.0f);
+    }
+
+    auto a1 = det3(b[0], b[3], b[2]);
+    auto a2 = det3(b[1], b[0], b[3]);
+    auto a3 = det3(b[2], b[1], b[0]);
+    auto d1 = a1 - 2.0f * a2 + 3.0f * a3;
+    auto d2 = 3.0f * a3 - a2;
+    auto d3 = 3.0f * a3;
+    auto dl = sqrtf(d1 * d1 + d2 * d2 + d3 * d3);
+
+    if (dl < EPSILON)
+        return form;
+
+    d1 /= dl;
+    d2 /= dl;
+    d3 /= dl;
+
+    auto disc = 3.0f * d2 * d2 - 4.0f * d1 * d3;
+
+    if (fabsf(d1) < EPSILON && fabsf(d2) < EPSILON) {
+        form.type = CubicType::Quadratic;
+    } else if (fabsf(d1) < EPSILON) {
+        form.type = CubicType::CuspAtInfinity;
+        form.ls   = d3;
+        form.lt   = 3.0f * d2;
+    } else if (disc >= 0.0f) {
+        auto root = sqrtf(3.0f * disc);
+
+        form.type = CubicType::Serpentine;
+        form.ls   = 3.0f * d2 - root;
+        form.lt   = 6.0f * d1;
+        form.ms   = 3.0f * d2 + root;
+        form.mt   = 6.0f * d1;
+    } else {
+        auto root = sqrtf(-disc);
+
+        form.type = CubicType::Loop;
+        form.ls   = d2 - root;
+        form.lt   = 2.0f * d1;
+        form.ms   = d2 + root;
+        form.mt   = 2.0f * d1;
+    }
+
+    return form;
+}
+
+/*
+ * Cubic Bernstein coefficients of the product of three linear factors,
+ * each given by its values at t = 0 and t = 1.
+ */
+static void linearProduct(Vec2 a, Vec2 b, Vec2 c, f32 *out)
+{
+    out[0] = a[0] * b[0] * c[0];
+    out[1] = (a[1] * b[0] * c[0] + a[0] * b[1] * c[0] + a[0] * b[0] * c[1]) / 3.0f;
+    out[2] = (a[1] * b[1] * c[0] + a[1] * b[0] * c[1] + a[0] * b[1] * c[1]) / 3.0f;
+    out[3] = a[1] * b[1] * c[1];
+}
+
+/*
+ * Klm of the control points.  On the curve k^3 = l * m, with k, l and m
+ * products of the factors L and M, and klm is an affine function of the
+ * position, so it can be interpolated over any triangles of the hull.
+ */
+static void cubicKlm(CubicForm const &form, Vec3 *klm)
+{
+    auto one = vec2(1.0f, 1.0f);
+    auto L   = vec2(form.ls, form.ls - form.lt);
+    auto M   = vec2(form.ms, form.ms - form.mt);
+    f32  k[4], l[4], m[4];
+
+    switch (form.type) {
+    case CubicType::Quadratic: {
+        auto T = vec2(0.0f, 1.0f);
+
+        linearProduct(T, one, one, k);
+        linearProduct(T, T, one, l);
+        linearProduct(T, one, one, m);
+    } break;
+    case CubicType::Serpentine:
+        linearProduct(L, M, one, k);
+        linearProduct(L, L, L, l);
+        linearProduct(M, M, M, m);
+        break;
+    case CubicType::Loop:
+        linearProduct(L, M, one, k);
+        linearProduct(L, L, M, l);
+        linearProduct(L, M, M, m);
+        break;
+    case CubicType::CuspAtInfinity:
+        linearProduct(L, one, one, k);
+        linearProduct(L, L, L, l);
+        linearProduct(one, one, one, m);
+        break;
+    case CubicType::Line:
+        for (auto idx = 0; idx < 4; ++idx)
+            k[idx] = l[idx] = m[idx] = 0.0f;
+        break;
+    }
+
+    for (auto idx = 0; idx < 4; ++idx)
+        klm[idx] = vec3(k[idx], l[idx], m[idx]);
+}
+
+/*
+ * Parameters in (0, 1) where the curve has to be split so every piece
+ * bounds a convex area with its chord, in increasing order.
+ */
+static u32 cubicSplits(CubicForm const &form, f32 *out)
+{
+    constexpr f32 MARGIN = 1e-3f;
+
+    auto count = u32(0);
+    auto add   = [&](f32 num, f32 den) {
+        if (den == 0.0f)
+            return;
+
+        auto t = num / den;
+
+        if (t > MARGIN && t < 1.0f - MARGIN)
+            out[count++] = t;
+    };
+
+    if (form.type == CubicType::Serpentine || form.type == CubicType::Loop) {
+        add(form.ls, form.lt);
+        add(form.ms, form.mt);
+    } else if (form.type == CubicType::CuspAtInfinity) {
+        add(form.ls, form.lt);
+    }
+
+    if (count == 2 && out[0] > out[1]) {
+        auto first = out[0];
+
+        out[0] = out[1];
+        out[1] = first;
+    }
+
+    return count;
+}
+
+static f32 cross2(Vec2 o, Vec2 a, Vec2 b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+/*
+ * Triangles covering the convex hull of the four control points, each
+ * vertex with its klm.  Returns the number of vertices written.
+ */
+static u32 hullTriangles(Vec2 const *cp, Vec3 const *klm, BezierFillVertex *out)
+{
+    i32 order[4] = { 0, 1, 2, 3 };
+
+    // Monotone chain, sorted by x then y.
+    for (auto i = 1; i < 4; ++i) {
+        for (auto j = i; j > 0; --j) {
+            auto& a = cp[order[j - 1]];
+            auto& b = cp[order[j]];
+
+            if (a.x < b.x || (a.x == b.x && a.y <= b.y))
+                break;
+
+            auto swap = order[j];
+
+            order[j]     = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    i32  hull[8];
+    auto count = 0;
+
+    for (auto i = 0; i < 4; ++i) {
+        while (count >= 2 && cross2(cp[hull[count - 2]], cp[hull[count - 1]], cp[order[i]]) <= 0.0f)
+            --count;
+        hull[count++] = order[i];
+    }
+    for (auto i = 2, lower = count + 1; i >= 0; --i) {
+        while (count >= lower && cross2(cp[hull[count - 2]], cp[hull[count - 1]], cp[order[i]]) <= 0.0f)
+            --count;
+        hull[count++] = order[i];
+    }
+    --count;    // the first point is also the last
+
+    auto written = u32(0);
+
+    for (auto i = 1; i + 1 < count; ++i) {
+        i32 tri[3] = { hull[0], hull[i], hull[i + 1] };
+
+        for (auto vtx = 0; vtx < 3; ++vtx)
+            out[written++] = BezierFillVertex{ cp[tri[vtx]], klm[tri[vtx]] };
+    }
+
+    return written;
+}
+
+BEZIER_FILL_DEF u32 bezierFillVertexBound(u32 curveCount)
+{
+    // The closing line adds one more fan triangle.
+    return curveCount * BEZIER_FILL_MAX_PIECES * BEZIER_FILL_PIECE_VERTICES + 3 + BEZIER_FILL_COVER_VERTICES;
+}
+
+BEZIER_FILL_DEF u32 triangulateBezierFill(Vec2 const *cp, u32 curveCount, BezierFillVertex *out)
+{
+    // Constant klm that is always inside, for the fan.
+    auto inside  = vec3(0.0f, 1.0f, 1.0f);
+    auto anchor  = cp[0];
+    auto written = u32(0);
+    auto lo      = cp[0];
+    auto hi      = cp[0];
+
+    auto fan = [&](Vec2 from, Vec2 to) {
+        out[written++] = BezierFillVertex{ anchor, inside };
+        out[written++] = BezierFillVertex{ from,   inside };
+        out[written++] = BezierFillVertex{ to,     inside };
+    };
+
+    for (u32 curve = 0; curve < curveCount; ++curve) {
+        auto points = cp + 3 * curve;
+        auto form   = classifyCubic(points);
+        f32  splits[2];
+        auto splitCnt = cubicSplits(form, splits);
+        auto prevT    = 0.0f;
+        auto rest     = CubicBezier{ { points[0], points[1], points[2], points[3] } };
+
+        for (auto idx = 1; idx < 4; ++idx) {
+            lo = min_of(lo, points[idx]);
+            hi = max_of(hi, points[idx]);
+        }
+
+        for (u32 piece = 0; piece <= splitCnt; ++piece) {
+            auto part = rest;
+
+            if (piece < splitCnt) {
+                auto tail = CubicBezier{};
+
+                // The rest starts at prevT, rescale the split to it.
+                splitBezierN(rest, (splits[piece] - prevT) / (1.0f - prevT), &part, &tail);
+                rest  = tail;
+                prevT = splits[piece];
+            }
+
+            auto partForm = classifyCubic(part.cp);
+
+            fan(part.cp[0], part.cp[3]);
+
+            if (partForm.type == CubicType::Line)
+                continue;
+
+            Vec3 klm[4];
+
+            cubicKlm(partForm, klm);
+
+            // Orient klm so the inside of the triangle under the curve is negative.
+            auto mid  = (klm[0] + 3.0f * klm[1] + 3.0f * klm[2] + klm[3]) / 8.0f;
+            auto test = (klm[0] + mid + klm[3]) / 3.0f;
+
+            if (test.x * test.x * test.x - test.y * test.z > 0.0f) {
+                for (auto idx = 0; idx < 4; ++idx) {
+                    klm[idx].x = -klm[idx].x;
+                    klm[idx].y = -klm[idx].y;
+                }
+            }
+
+            written += hullTriangles(part.cp, klm, out + written);
+        }
+    }
+
+    auto last = cp[3 * curveCount];
+
+    if (last.x != anchor.x || last.y != anchor.y)
+        fan(last, anchor);
+
+    // The outline stays inside the control points' box.
+    Vec2 box[BEZIER_FILL_COVER_VERTICES] = {
+        lo, vec2(hi.x, lo.y), hi,
+        lo, hi, vec2(lo.x, hi.y),
+    };
+
+    for (u32 idx = 0; idx < BEZIER_FILL_COVER_VERTICES; ++idx)
+        out[written + idx] = BezierFillVertex{ box[idx], inside };
+
+    return written;
+}
+
+BEZIER_FILL_DEF BezierFill makeBezierFill(u32 curveCount)
+{
+    constexpr GLsizei STRIDE = sizeof(BezierFillVertex);
+
+    auto fill = BezierFill{};
+
+    fill.gpuCapacity = GLsizei(bezierFillVertexBound(curveCount));
+
+    glGenVertexArrays(1, &fill.vao);
+    glGenBuffers(1, &fill.vbo);
+    glBindVertexArray(fill.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, fill.vbo);
+    glBufferData(GL_ARRAY_BUFFER, fill.gpuCapacity * STRIDE, nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offsetof(BezierFillVertex, pos));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offsetof(BezierFillVertex, klm));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    return fill;
+}
+
+BEZIER_FILL_DEF void freeBezierFill(BezierFill *fill)
+{
+    glDeleteBuffers(1, &fill->vbo);
+    glDeleteVertexArrays(1, &fill->vao);
+    *fill = BezierFill{};
+}
+
+BEZIER_FILL_DEF void loadBezierFill(BezierFill *fill, Vec2 const *cp, u32 curveCount, StreamBuffer *stream, RenderState *state)
+{
+    constexpr u32 STRIDE = sizeof(BezierFillVertex);
+
+    auto bound = bezierFillVertexBound(curveCount);
+    auto verts = (BezierFillVertex*) beginStreamWrite(stream, fill->vbo, 0, bound * STRIDE);
+    auto count = triangulateBezierFill(cp, curveCount, verts);
+    auto total = count + BEZIER_FILL_COVER_VERTICES;
+
+    fill->vertexCount = GLsizei(count);
+    if (GLsizei(total) > fill->gpuCapacity) {
+        while (fill->gpuCapacity < GLsizei(total))
+            fill->gpuCapacity *= 2;
+        glBindBuffer(GL_ARRAY_BUFFER, fill->vbo);
+        glBufferData(GL_ARRAY_BUFFER, fill->gpuCapacity * STRIDE, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    endStreamWrite(stream, state, total * STRIDE);
+}
+
+BEZIER_FILL_DEF void
+renderBezierFill(BezierFill       *fill,
+                 BezierFillShader *shader,
+                 RenderState      *state,
+                 Mat4             *mvp,
+                 Vec4              color)
+{
+    if (fill->vertexCount == 0)
+        return;
+
+    // Pieces of hull and fan overlap and face both ways.
+    auto isCulling = isCapabilityEnabled(state, GL_CULL_FACE);
+
+    setCapability(state, GL_CULL_FACE, false);
+    setCapability(state, GL_STENCIL_TEST, true);
+    setProgram(state, shader->programId);
+    glUniformMatrix4fv(shader->MVP_uniform, 1, GL_FALSE, mvp->data);
+    glUniform4f(shader->color_uniform, color.r, color.g, color.b, color.a);
+    setVertexArray(state, fill->vao);
+
+    // Every kept fragment flips the low stencil bit, odd is inside.
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glStencilMask(0x01);
+    glStencilFunc(GL_ALWAYS, 0, 0x01);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+    glDrawArrays(GL_TRIANGLES, 0, fill->vertexCount);
+
+    // Cover what is inside and clear the stencil on the way.
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilFunc(GL_NOTEQUAL, 0, 0x01);
+    glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+    glDrawArrays(GL_TRIANGLES, fill->vertexCount, BEZIER_FILL_COVER_VERTICES);
+
+    setVertexArray(state, 0);
+    setCapability(state, GL_STENCIL_TEST, false);
+    setCapability(state, GL_CULL_FACE, isCulling);
+}
+
+#endif // BEZIER_FILL_IMPLEMENTATION
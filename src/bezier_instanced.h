@@ -0,0 +1,223 @@
+#ifndef GUARD_INCLUDE_BEZIER_INSTANCED_H
+#define GUARD_INCLUDE_BEZIER_INSTANCED_H
+
+#ifdef BEZIER_INSTANCED_STATIC
+    #define BEZIER_INSTANCED_DEF static
+#else
+    #define BEZIER_INSTANCED_DEF extern
+#endif
+
+#include <glad/glad.h>
+
+#include "m3d.h"
+#include "common.h"
+#include "render_state.h"
+#include "bezier_n.h"
+
+/*
+ * Everything needed to draw one curve, laid out as one element of the
+ * instance buffer.  Weights make it a rational cubic, all 1 for a plain
+ * one (see rationalBezierInstance for the homogeneous form).  Width is
+ * in pixels.
+ */
+struct BezierInstance {
+    Vec2 cp[4];
+    Vec4 weights;
+    Vec4 color;
+    f32  width;
+};
+
+/*
+ * A set of curves that share a segment count and are drawn with a single
+ * instanced draw call.  The curve is expanded into a triangle strip in
+ * the vertex shader so width can differ per curve.
+ */
+struct BezierInstances {
+    BezierInstance *data;
+    u32             count;
+    u32             capacity;
+    u32             segments;
+    bool            isDirty;
+
+    GLuint  vao;
+    GLuint  vbo;
+    GLsizei gpuCapacity;
+};
+
+struct BezierInstanceShader {
+    GLuint programId;
+    GLuint MVP_uniform;
+    GLuint viewport_uniform;
+    GLuint segments_uniform;
+};
+
+/*
+ * Instance for the rational cubic curve, conic arcs from conicArc go
+ * through elevateBezier first.  Every weight has to be positive.
+ */
+BEZIER_INSTANCED_DEF BezierInstance rationalBezierInstance(RationalCubic const &curve, Vec4 color, f32 width);
+
+BEZIER_INSTANCED_DEF BezierInstances makeBezierInstances(u32 capacity, u32 segments);
+BEZIER_INSTANCED_DEF void            freeBezierInstances(BezierInstances *inst);
+
+/*
+ * Append a curve and return its index.  Curves are uploaded lazily on
+ * the next render.
+ */
+BEZIER_INSTANCED_DEF u32  addBezierInstance(BezierInstances *inst, BezierInstance const &curve);
+BEZIER_INSTANCED_DEF void clearBezierInstances(BezierInstances *inst);
+
+/*
+ * Draw every curve with one glDrawArraysInstanced.  Viewport is the size
+ * of the viewport in pixels.
+ */
+BEZIER_INSTANCED_DEF void renderBezierInstances(BezierInstances      *inst,
+                                                BezierInstanceShader *shader,
+                                                RenderState          *state,
+                                                Mat4                 *mvp,
+                                                Vec2                  viewport);
+
+#endif // GUARD_INCLUDE_BEZIER_INSTANCED_H
+
+
+#ifdef BEZIER_INSTANCED_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <SDL_log.h>
+
+BEZIER_INSTANCED_DEF BezierInstance rationalBezierInstance(RationalCubic const &curve, Vec4 color, f32 width)
+{
+    auto inst = BezierInstance{};
+
+    for (auto cp = 0; cp < 4; ++cp) {
+        inst.cp[cp]      = projectPoint(curve.cp[cp]);
+        inst.weights[cp] = curve.cp[cp].z;
+    }
+    inst.color = color;
+    inst.width = width;
+
+    return inst;
+}
+
+BEZIER_INSTANCED_DEF BezierInstances makeBezierInstances(u32 capacity, u32 segments)
+{
+    constexpr GLsizei STRIDE = sizeof(BezierInstance);
+
+    auto inst = BezierInstances{};
+
+    if (capacity == 0)
+        capacity = 1;
+
+    inst.data     = (BezierInstance*) malloc(capacity * sizeof(BezierInstance));
+    inst.capacity = capacity;
+    inst.segments = segments;
+
+    if (inst.data == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for %u bezier instances.\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+
+    glGenVertexArrays(1, &inst.vao);
+    glGenBuffers(1, &inst.vbo);
+
+    inst.gpuCapacity = GLsizei(capacity);
+    glBindVertexArray(inst.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, inst.vbo);
+    glBufferData(GL_ARRAY_BUFFER, inst.gpuCapacity * STRIDE, nullptr, GL_DYNAMIC_DRAW);
+
+    for (GLuint cp = 0; cp < 4; ++cp) {
+        auto offset = offsetof(BezierInstance, cp) + cp * sizeof(Vec2);
+
+        glVertexAttribPointer(cp, 2, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offset);
+        glVertexAttribDivisor(cp, 1);
+        glEnableVertexAttribArray(cp);
+    }
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offsetof(BezierInstance, color));
+    glVertexAttribDivisor(4, 1);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offsetof(BezierInstance, width));
+    glVertexAttribDivisor(5, 1);
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, STRIDE, (GLvoid*) offsetof(BezierInstance, weights));
+    glVertexAttribDivisor(6, 1);
+    glEnableVertexAttribArray(6);
+    glBindVertexArray(0);
+
+    return inst;
+}
+
+BEZIER_INSTANCED_DEF void freeBezierInstances(BezierInstances *inst)
+{
+    glDeleteBuffers(1, &inst->vbo);
+    glDeleteVertexArrays(1, &inst->vao);
+    free(inst->data);
+    *inst = BezierInstances{};
+}
+
+BEZIER_INSTANCED_DEF u32 addBezierInstance(BezierInstances *inst, BezierInstance const &curve)
+{
+    if (inst->count == inst->capacity) {
+        auto capacity = inst->capacity * 2;
+        auto data     = (BezierInstance*) realloc(inst->data, capacity * sizeof(BezierInstance));
+
+        if (data == nullptr) {
+            SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                            "Not enough memory for %u bezier instances.\n", capacity);
+            exit(EXIT_FAILURE);
+        }
+        inst->data     = data;
+        inst->capacity = capacity;
+    }
+
+    inst->data[inst->count] = curve;
+    inst->isDirty           = true;
+
+    return inst->count++;
+}
+
+BEZIER_INSTANCED_DEF void clearBezierInstances(BezierInstances *inst)
+{
+    inst->count   = 0;
+    inst->isDirty = true;
+}
+
+BEZIER_INSTANCED_DEF void
+renderBezierInstances(BezierInstances      *inst,
+                      BezierInstanceShader *shader,
+                      RenderState          *state,
+                      Mat4                 *mvp,
+                      Vec2                  viewport)
+{
+    constexpr GLsizei STRIDE = sizeof(BezierInstance);
+
+    if (inst->count == 0)
+        return;
+
+    if (inst->isDirty) {
+        glBindBuffer(GL_ARRAY_BUFFER, inst->vbo);
+        if (GLsizei(inst->count) > inst->gpuCapacity) {
+            inst->gpuCapacity = GLsizei(inst->capacity);
+            glBufferData(GL_ARRAY_BUFFER, inst->gpuCapacity * STRIDE, nullptr, GL_DYNAMIC_DRAW);
+        }
+        bufferSubData(state, GL_ARRAY_BUFFER, 0, inst->count * STRIDE, (GLvoid*) inst->data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        inst->isDirty = false;
+    }
+
+    // Strips alternate winding so both faces have to be drawn.
+    auto isCulling = isCapabilityEnabled(state, GL_CULL_FACE);
+
+    setCapability(state, GL_CULL_FACE, false);
+    setProgram(state, shader->programId);
+    glUniformMatrix4fv(shader->MVP_uniform, 1, GL_FALSE, mvp->data);
+    glUniform2f(shader->viewport_uniform, viewport.x, viewport.y);
+    glUniform1i(shader->segments_uniform, GLint(inst->segments));
+    setVertexArray(state, inst->vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, GLsizei(2 * (inst->segments + 1)), GLsizei(inst->count));
+    setVertexArray(state, 0);
+    setCapability(state, GL_CULL_FACE, isCulling);
+}
+
+#endif // BEZIER_INSTANCED_IMPLEMENTATION
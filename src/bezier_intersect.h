@@ -0,0 +1,411 @@
+#ifndef GUARD_INCLUDE_BEZIER_INTERSECT_H
+#define GUARD_INCLUDE_BEZIER_INTERSECT_H
+
+#ifdef BEZIER_INTERSECT_STATIC
+    #define BEZIER_INTERSECT_DEF static
+#else
+    #define BEZIER_INTERSECT_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier_scene.h"
+#include "bezier_query.h"
+
+// Two cubics that cross more often than this overlap along a stretch.
+constexpr i32 BEZIER_INTERSECT_MAX = 9;
+
+struct BezierIntersection {
+    u32  curveA;        // dense scene indices, curveA < curveB
+    u32  curveB;
+    f32  tA;
+    f32  tB;
+    Vec2 point;
+};
+
+/*
+ * Intersections of a whole scene.  candidatePairs counts the pairs whose
+ * bounds overlap, every one of them is tested.  degeneratePairs counts
+ * the pairs that overlap along a stretch or touch too tangentially to
+ * resolve, they add no intersections.
+ */
+struct BezierIntersections {
+    BezierIntersection *data;
+    u32                 count;
+    u32                 capacity;
+    u64                 candidatePairs;
+    u32                 degeneratePairs;
+};
+
+/*
+ * Intersect the cubics a and b by recursive subdivision.  Subcurve pairs
+ * are dropped when their control polygon bounds don't overlap and the
+ * larger one is split until both are within tolerance of their chords,
+ * then the chords are intersected.  Writes (tA, tB) of each intersection
+ * to params and returns how many there are, or -1 for a degenerate pair.
+ */
+BEZIER_INTERSECT_DEF i32 intersectCubics(Vec2 const *a, Vec2 const *b, f32 tolerance, Vec2 *params);
+
+/*
+ * Find every intersection between different curves of scene.  The BVH
+ * is the broad phase and has to be built (or refit) for the current
+ * control points.  With more than one thread the curves are handed out
+ * to the threads in chunks, the intersections are then in no particular
+ * order.
+ */
+BEZIER_INTERSECT_DEF void intersectBezierScene(BezierScene const   *scene,
+                                               BezierBvh const     *bvh,
+                                               f32                  tolerance,
+                                               i32                  threadCount,
+                                               BezierIntersections *out);
+
+BEZIER_INTERSECT_DEF void freeBezierIntersections(BezierIntersections *list);
+
+#endif // GUARD_INCLUDE_BEZIER_INTERSECT_H
+
+
+#ifdef BEZIER_INTERSECT_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+#include <SDL_log.h>
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
+
+#if !defined(BEZIER_INTERSECT_MAX_DEPTH)
+    #define BEZIER_INTERSECT_MAX_DEPTH 32
+#endif
+
+#if !defined(BEZIER_INTERSECT_MAX_STEPS)
+    #define BEZIER_INTERSECT_MAX_STEPS 4096
+#endif
+
+#if !defined(BEZIER_INTERSECT_CHUNK)
+    #define BEZIER_INTERSECT_CHUNK 64
+#endif
+
+// Hits this close in both parameters are the same intersection found twice.
+constexpr f32 BEZIER_INTERSECT_MERGE = 1e-3f;
+
+constexpr i32 BEZIER_INTERSECT_MAX_THREADS = 64;
+
+struct CubicSpan {
+    Vec2 cp[4];
+    f32  t0;
+    f32  t1;
+};
+
+struct SpanPair {
+    CubicSpan a;
+    CubicSpan b;
+    i32       depth;
+};
+
+static void splitSpan(CubicSpan const &span, CubicSpan *lo, CubicSpan *hi)
+{
+    auto p01  = 0.5f * (span.cp[0] + span.cp[1]);
+    auto p12  = 0.5f * (span.cp[1] + span.cp[2]);
+    auto p23  = 0.5f * (span.cp[2] + span.cp[3]);
+    auto p012 = 0.5f * (p01 + p12);
+    auto p123 = 0.5f * (p12 + p23);
+    auto mid  = 0.5f * (p012 + p123);
+    auto tMid = 0.5f * (span.t0 + span.t1);
+
+    *lo = CubicSpan{ { span.cp[0], p01, p012, mid }, span.t0, tMid };
+    *hi = CubicSpan{ { mid, p123, p23, span.cp[3] }, tMid, span.t1 };
+}
+
+static BezierBounds hullBounds(Vec2 const *cp)
+{
+    return BezierBounds{ min_of(min_of(cp[0], cp[1]), min_of(cp[2], cp[3])),
+                         max_of(max_of(cp[0], cp[1]), max_of(cp[2], cp[3])) };
+}
+
+/*
+ * Within tolerance of its chord, also in parametrization: the inner
+ * control points are where a straight line's would be.
+ */
+static bool isSpanFlat(CubicSpan const &span, f32 toleranceSq)
+{
+    auto third = (span.cp[3] - span.cp[0]) / 3.0f;
+
+    return len_sq(span.cp[1] - (span.cp[0] + third)) <= toleranceSq
+        && len_sq(span.cp[2] - (span.cp[3] - third)) <= toleranceSq;
+}
+
+static f32 cross(Vec2 a, Vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+/*
+ * Intersect the chords of a and b and write the curve parameters to hit.
+ * Parallel chords don't intersect, their curves are either apart or
+ * overlap, which the step limit catches.
+ */
+static bool intersectChords(CubicSpan const &a, CubicSpan const &b, Vec2 *hit)
+{
+    // Slack so hits on the shared end of neighbouring spans are not lost.
+    constexpr f32 SLACK = 1e-4f;
+
+    auto da    = a.cp[3] - a.cp[0];
+    auto db    = b.cp[3] - b.cp[0];
+    auto denom = cross(da, db);
+
+    if (fabsf(denom) <= 1e-12f * sqrtf(len_sq(da) * len_sq(db)) || denom == 0.0f)
+        return false;
+
+    auto diff = b.cp[0] - a.cp[0];
+    auto s    = cross(diff, db) / denom;
+    auto u    = cross(diff, da) / denom;
+
+    if (s < -SLACK || s > 1.0f + SLACK || u < -SLACK || u > 1.0f + SLACK)
+        return false;
+
+    s = clamp(s, 0.0f, 1.0f);
+    u = clamp(u, 0.0f, 1.0f);
+    *hit = vec2(a.t0 + s * (a.t1 - a.t0), b.t0 + u * (b.t1 - b.t0));
+
+    return true;
+}
+
+static bool isOverlappingHull(CubicSpan const &a, CubicSpan const &b)
+{
+    auto boxA = hullBounds(a.cp);
+    auto boxB = hullBounds(b.cp);
+
+    return boxA.min.x <= boxB.max.x && boxB.min.x <= boxA.max.x
+        && boxA.min.y <= boxB.max.y && boxB.min.y <= boxA.max.y;
+}
+
+BEZIER_INTERSECT_DEF i32 intersectCubics(Vec2 const *a, Vec2 const *b, f32 tolerance, Vec2 *params)
+{
+    // Depth first with the larger span split, so at most one pending pair per level.
+    SpanPair stack[BEZIER_INTERSECT_MAX_DEPTH + 2];
+
+    auto top         = 0;
+    auto count       = 0;
+    auto toleranceSq = tolerance * tolerance;
+
+    stack[top++] = SpanPair{ CubicSpan{ { a[0], a[1], a[2], a[3] }, 0.0f, 1.0f },
+                             CubicSpan{ { b[0], b[1], b[2], b[3] }, 0.0f, 1.0f },
+                             0 };
+
+    for (auto step = 0; top > 0; ++step) {
+        if (step == BEZIER_INTERSECT_MAX_STEPS)
+            return -1;
+
+        auto pair = stack[--top];
+
+        if (!isOverlappingHull(pair.a, pair.b))
+            continue;
+
+        auto isFlatA = isSpanFlat(pair.a, toleranceSq);
+        auto isFlatB = isSpanFlat(pair.b, toleranceSq);
+
+        if ((isFlatA && isFlatB) || pair.depth == BEZIER_INTERSECT_MAX_DEPTH) {
+            Vec2 hit;
+
+            if (!intersectChords(pair.a, pair.b, &hit))
+                continue;
+
+            auto isKnown = false;
+            for (auto idx = 0; idx < count && !isKnown; ++idx) {
+                isKnown = fabsf(params[idx].x - hit.x) < BEZIER_INTERSECT_MERGE
+                       && fabsf(params[idx].y - hit.y) < BEZIER_INTERSECT_MERGE;
+            }
+            if (isKnown)
+                continue;
+
+            if (count == BEZIER_INTERSECT_MAX)
+                return -1;
+            params[count++] = hit;
+            continue;
+        }
+
+        auto extentA  = hullBounds(pair.a.cp);
+        auto extentB  = hullBounds(pair.b.cp);
+        auto sizeA    = len_sq(extentA.max - extentA.min);
+        auto sizeB    = len_sq(extentB.max - extentB.min);
+        auto isSplitA = !isFlatA && (isFlatB || sizeA >= sizeB);
+
+        CubicSpan lo, hi;
+        auto      depth = pair.depth + 1;
+
+        if (isSplitA) {
+            splitSpan(pair.a, &lo, &hi);
+            stack[top++] = SpanPair{ hi, pair.b, depth };
+            stack[top++] = SpanPair{ lo, pair.b, depth };
+        } else {
+            splitSpan(pair.b, &lo, &hi);
+            stack[top++] = SpanPair{ pair.a, hi, depth };
+            stack[top++] = SpanPair{ pair.a, lo, depth };
+        }
+    }
+
+    return count;
+}
+
+static void growIntersections(BezierIntersections *list, u32 capacity)
+{
+    auto data = (BezierIntersection*) realloc(list->data, capacity * sizeof(BezierIntersection));
+
+    if (data == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for %u intersections.\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    list->data     = data;
+    list->capacity = capacity;
+}
+
+static void pushIntersection(BezierIntersections *list, BezierIntersection const &hit)
+{
+    if (list->count == list->capacity)
+        growIntersections(list, list->capacity > 0 ? 2 * list->capacity : 256);
+
+    list->data[list->count++] = hit;
+}
+
+struct IntersectWorker {
+    BezierScene const   *scene;
+    BezierBvh const     *bvh;
+    f32                  tolerance;
+    SDL_atomic_t        *nextItem;
+    BezierIntersections  result;
+};
+
+/*
+ * Take chunks of BVH items until none are left and test each curve
+ * against the overlapping curves after it in dense order, so every pair
+ * is tested once.
+ */
+static int SDLCALL intersectChunks(void *data)
+{
+    auto  worker     = (IntersectWorker*) data;
+    auto  bvh        = worker->bvh;
+    auto  scene      = worker->scene;
+    auto  result     = &worker->result;
+    u32  *overlaps   = nullptr;
+    auto  overlapCap = u32(0);
+    defer(free(overlaps));
+
+    auto controlPoints = [&](u32 idx, Vec2 *cp) {
+        for (auto i = 0; i < 4; ++i)
+            cp[i] = bezierControlPoint(scene, idx, i);
+    };
+
+    for (;;) {
+        auto first = u32(SDL_AtomicAdd(worker->nextItem, BEZIER_INTERSECT_CHUNK));
+
+        if (first >= bvh->itemCount)
+            break;
+
+        auto last = first + BEZIER_INTERSECT_CHUNK < bvh->itemCount ? first + BEZIER_INTERSECT_CHUNK : bvh->itemCount;
+
+        for (auto item = first; item < last; ++item) {
+            auto curveA = bvh->items[item];
+            auto count  = queryBezierBvh(bvh, bvh->curveBounds[curveA], overlaps, overlapCap);
+
+            if (count > overlapCap) {
+                overlapCap = count + count / 2;
+                overlaps   = (u32*) realloc(overlaps, overlapCap * sizeof(u32));
+                if (overlaps == nullptr) {
+                    SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                                    "Not enough memory for %u overlapping curves.\n", overlapCap);
+                    exit(EXIT_FAILURE);
+                }
+                queryBezierBvh(bvh, bvh->curveBounds[curveA], overlaps, overlapCap);
+            }
+
+            Vec2 cpA[4];
+            controlPoints(curveA, cpA);
+
+            for (u32 idx = 0; idx < count; ++idx) {
+                auto curveB = overlaps[idx];
+
+                if (curveB <= curveA)
+                    continue;
+
+                Vec2 cpB[4];
+                Vec2 params[BEZIER_INTERSECT_MAX];
+
+                controlPoints(curveB, cpB);
+                result->candidatePairs += 1;
+
+                auto hits = intersectCubics(cpA, cpB, worker->tolerance, params);
+
+                if (hits < 0) {
+                    result->degeneratePairs += 1;
+                    continue;
+                }
+
+                for (auto hit = 0; hit < hits; ++hit) {
+                    auto t  = params[hit].x;
+                    auto mt = 1.0f - t;
+                    auto pt = mt * mt * mt * cpA[0] + 3.0f * mt * mt * t * cpA[1]
+                            + 3.0f * mt * t * t * cpA[2] + t * t * t * cpA[3];
+
+                    pushIntersection(result, BezierIntersection{ curveA, curveB, params[hit].x, params[hit].y, pt });
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+BEZIER_INTERSECT_DEF void
+intersectBezierScene(BezierScene const   *scene,
+                     BezierBvh const     *bvh,
+                     f32                  tolerance,
+                     i32                  threadCount,
+                     BezierIntersections *out)
+{
+    IntersectWorker workers[BEZIER_INTERSECT_MAX_THREADS];
+    SDL_Thread     *threads[BEZIER_INTERSECT_MAX_THREADS];
+    SDL_atomic_t    nextItem = {};
+
+    if (threadCount < 1)                            threadCount = 1;
+    if (threadCount > BEZIER_INTERSECT_MAX_THREADS) threadCount = BEZIER_INTERSECT_MAX_THREADS;
+
+    out->count           = 0;
+    out->candidatePairs  = 0;
+    out->degeneratePairs = 0;
+
+    // Worker 0 is this thread and collects straight into out.
+    for (auto idx = 0; idx < threadCount; ++idx)
+        workers[idx] = IntersectWorker{ scene, bvh, tolerance, &nextItem, BezierIntersections{} };
+    workers[0].result = *out;
+
+    for (auto idx = 1; idx < threadCount; ++idx) {
+        threads[idx] = SDL_CreateThread(intersectChunks, "intersect", &workers[idx]);
+        if (threads[idx] == nullptr)
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Couldn't start an intersection thread: %s\n", SDL_GetError());
+    }
+
+    intersectChunks(&workers[0]);
+    *out = workers[0].result;
+
+    for (auto idx = 1; idx < threadCount; ++idx) {
+        auto& result = workers[idx].result;
+
+        if (threads[idx] != nullptr)
+            SDL_WaitThread(threads[idx], nullptr);
+
+        for (u32 hit = 0; hit < result.count; ++hit)
+            pushIntersection(out, result.data[hit]);
+        out->candidatePairs  += result.candidatePairs;
+        out->degeneratePairs += result.degeneratePairs;
+        freeBezierIntersections(&result);
+    }
+}
+
+BEZIER_INTERSECT_DEF void freeBezierIntersections(BezierIntersections *list)
+{
+    free(list->data);
+    *list = BezierIntersections{};
+}
+
+#endif // BEZIER_INTERSECT_IMPLEMENTATION
@@ -0,0 +1,352 @@
+#ifndef GUARD_INCLUDE_BEZIER_LENGTH_H
+#define GUARD_INCLUDE_BEZIER_LENGTH_H
+
+#ifdef BEZIER_LENGTH_STATIC
+    #define BEZIER_LENGTH_DEF static
+#else
+    #define BEZIER_LENGTH_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier_n.h"
+
+#if !defined(BEZIER_LENGTH_STEPS)
+    #define BEZIER_LENGTH_STEPS 32          // table intervals per curve
+#endif
+
+#if !defined(BEZIER_LENGTH_NEWTON_STEPS)
+    #define BEZIER_LENGTH_NEWTON_STEPS 1
+#endif
+
+#if !defined(BEZIER_LENGTH_MAX_DEPTH)
+    #define BEZIER_LENGTH_MAX_DEPTH 8       // halvings of an interval near a cusp
+#endif
+
+/*
+ * Arc length of one cubic at BEZIER_LENGTH_STEPS + 1 evenly spaced
+ * parameters, lengths[i] is the length from t = 0 to t = i / STEPS and
+ * speeds[i] the speed there.  Every interval is integrated with
+ * Gauss-Legendre quadrature of the speed, and halved until the halves
+ * agree where the speed has a kink, close to a cusp.
+ *
+ * A table is built for the control points it was last updated with and
+ * updateBezierLengthTable only rebuilds it when they change, so a table
+ * kept next to a curve is built lazily and never goes stale.
+ */
+struct BezierLengthTable {
+    CubicBezier     curve;
+    QuadraticBezier hodograph;
+    f32             lengths[BEZIER_LENGTH_STEPS + 1];
+    f32             speeds[BEZIER_LENGTH_STEPS + 1];
+    bool            isKinked[BEZIER_LENGTH_STEPS];  // integrated adaptively
+    bool            isBuilt;
+};
+
+/*
+ * Rebuild table if it wasn't built for cp, returns true if it was.
+ */
+BEZIER_LENGTH_DEF bool updateBezierLengthTable(BezierLengthTable *table, Vec2 const *cp);
+
+inline f32 bezierLength(BezierLengthTable const *table)
+{
+    return table->lengths[BEZIER_LENGTH_STEPS];
+}
+
+/*
+ * Parameter of the point length along the curve, clamped to [0, 1]:
+ * binary search in the table, cubic Hermite interpolation of t over
+ * length in the interval found and Newton steps on the exact length.
+ */
+BEZIER_LENGTH_DEF f32 bezierLengthToParam(BezierLengthTable const *table, f32 length);
+
+/*
+ * bezierLengthToParam for count lengths, in any order.
+ */
+BEZIER_LENGTH_DEF void bezierLengthsToParams(BezierLengthTable const *table, f32 const *lengths, u32 count, f32 *outT);
+
+/*
+ * Markers every spacing along the curve, the first offset from its
+ * start.  Writes at most capacity positions to outPos and unit
+ * directions of travel to outDir (which may be nullptr) and returns the
+ * number of markers.
+ */
+BEZIER_LENGTH_DEF u32 placeBezierMarkers(BezierLengthTable const *table,
+                                         f32                      offset,
+                                         f32                      spacing,
+                                         u32                      capacity,
+                                         Vec2                    *outPos,
+                                         Vec2                    *outDir,
+                                         Arena                   *scratch);
+
+/*
+ * Dashes dash long with gap between them, the pattern shifted offset
+ * back along the curve.  Writes the start and end parameter of each
+ * dash, clipped to the curve, to outT and returns the number of dashes,
+ * at most capacity.
+ */
+BEZIER_LENGTH_DEF u32 bezierDashParams(BezierLengthTable const *table,
+                                       f32                      offset,
+                                       f32                      dash,
+                                       f32                      gap,
+                                       u32                      capacity,
+                                       f32                     *outT);
+
+#endif // GUARD_INCLUDE_BEZIER_LENGTH_H
+
+
+#ifdef BEZIER_LENGTH_IMPLEMENTATION
+
+#include <string.h>
+#include <math.h>
+#include <SDL_log.h>
+
+#include "bezier_batch.h"
+
+/*
+ * Gauss-Legendre nodes and weights on [-1, 1].  Five points are exact for
+ * polynomials up to degree nine and three up to degree five, on a table
+ * interval the two only disagree where the speed has a kink.
+ */
+static f32 const BEZIER_GAUSS5_X[5] = { -0.9061798459f, -0.5384693101f, 0.0f, 0.5384693101f, 0.9061798459f };
+static f32 const BEZIER_GAUSS5_W[5] = {  0.2369268851f,  0.4786286705f, 0.5688888889f, 0.4786286705f, 0.2369268851f };
+static f32 const BEZIER_GAUSS3_X[3] = { -0.7745966692f, 0.0f, 0.7745966692f };
+static f32 const BEZIER_GAUSS3_W[3] = {  0.5555555556f, 0.8888888889f, 0.5555555556f };
+
+static f32 bezierSpeed(BezierLengthTable const *table, f32 t)
+{
+    return sqrtf(len_sq(evalBezierN(table->hodograph, t)));
+}
+
+template <i32 Points>
+static f32 integrateSpeed(BezierLengthTable const *table, f32 const *x, f32 const *w, f32 from, f32 to)
+{
+    auto half   = 0.5f * (to - from);
+    auto middle = 0.5f * (to + from);
+    auto sum    = 0.0f;
+
+    for (auto idx = 0; idx < Points; ++idx)
+        sum += w[idx] * bezierSpeed(table, middle + half * x[idx]);
+
+    return half * sum;
+}
+
+static f32 integrateSpeed5(BezierLengthTable const *table, f32 from, f32 to)
+{
+    return integrateSpeed<5>(table, BEZIER_GAUSS5_X, BEZIER_GAUSS5_W, from, to);
+}
+
+static f32 integrateSpeed3(BezierLengthTable const *table, f32 from, f32 to)
+{
+    return integrateSpeed<3>(table, BEZIER_GAUSS3_X, BEZIER_GAUSS3_W, from, to);
+}
+
+/*
+ * Halve until the halves agree with the whole, whole is the five point
+ * quadrature of from to to.
+ */
+static f32 integrateAdaptive(BezierLengthTable const *table, f32 from, f32 to, f32 whole, i32 depth)
+{
+    auto middle = 0.5f * (from + to);
+    auto left   = integrateSpeed5(table, from, middle);
+    auto right  = integrateSpeed5(table, middle, to);
+
+    // Agreeing to 1e-6 of the length leaves f32 rounding as the larger error.
+    if (depth >= BEZIER_LENGTH_MAX_DEPTH || fabsf(left + right - whole) <= 1e-6f * (left + right))
+        return left + right;
+
+    return integrateAdaptive(table, from, middle, left, depth + 1)
+         + integrateAdaptive(table, middle, to, right, depth + 1);
+}
+
+/* Length from the start of interval step, at from, to t. */
+static f32 partialLength(BezierLengthTable const *table, u32 step, f32 from, f32 t)
+{
+    if (table->isKinked[step])
+        return integrateAdaptive(table, from, t, integrateSpeed5(table, from, t), 0);
+
+    return integrateSpeed3(table, from, t);
+}
+
+BEZIER_LENGTH_DEF bool updateBezierLengthTable(BezierLengthTable *table, Vec2 const *cp)
+{
+    if (table->isBuilt && memcmp(table->curve.cp, cp, sizeof(table->curve.cp)) == 0)
+        return false;
+
+    for (auto idx = 0; idx < 4; ++idx)
+        table->curve.cp[idx] = cp[idx];
+    table->hodograph  = bezierDerivative(table->curve);
+    table->lengths[0] = 0.0f;
+    table->speeds[0]  = bezierSpeed(table, 0.0f);
+
+    for (u32 step = 0; step < BEZIER_LENGTH_STEPS; ++step) {
+        auto from  = f32(step) / f32(BEZIER_LENGTH_STEPS);
+        auto to    = f32(step + 1) / f32(BEZIER_LENGTH_STEPS);
+        auto whole = integrateSpeed5(table, from, to);
+
+        table->isKinked[step] = fabsf(whole - integrateSpeed3(table, from, to)) > 1e-4f * whole;
+        if (table->isKinked[step])
+            whole = integrateAdaptive(table, from, to, whole, 0);
+        table->lengths[step + 1] = table->lengths[step] + whole;
+        table->speeds[step + 1]  = bezierSpeed(table, to);
+    }
+    table->isBuilt = true;
+
+    return true;
+}
+
+BEZIER_LENGTH_DEF f32 bezierLengthToParam(BezierLengthTable const *table, f32 length)
+{
+    auto const *lengths = table->lengths;
+
+    if (length <= 0.0f)
+        return 0.0f;
+    if (length >= lengths[BEZIER_LENGTH_STEPS])
+        return 1.0f;
+
+    // Last interval starting at or before length.
+    auto lo = u32(0);
+    auto hi = u32(BEZIER_LENGTH_STEPS);
+
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) / 2;
+
+        if (lengths[mid] <= length) lo = mid;
+        else                        hi = mid;
+    }
+
+    auto from  = f32(lo) / f32(BEZIER_LENGTH_STEPS);
+    auto to    = f32(lo + 1) / f32(BEZIER_LENGTH_STEPS);
+    auto span  = lengths[lo + 1] - lengths[lo];
+    auto width = to - from;
+    auto slack = 1e-6f * lengths[BEZIER_LENGTH_STEPS];
+
+    if (span <= 0.0f)
+        return from;
+
+    /*
+     * dt/ds is 1 / speed at the ends.  Slopes over three times the
+     * secant's would make t run backwards (Fritsch and Carlson), a stop
+     * has an infinite one, both are clamped.
+     */
+    auto u      = (length - lengths[lo]) / span;
+    auto limit  = 3.0f * width;
+    auto slope0 = table->speeds[lo] * limit > span ? span / table->speeds[lo] : limit;
+    auto slope1 = table->speeds[lo + 1] * limit > span ? span / table->speeds[lo + 1] : limit;
+    auto u2     = u * u;
+    auto u3     = u2 * u;
+    auto t      = from
+                + (3.0f * u2 - 2.0f * u3) * width
+                + (u3 - 2.0f * u2 + u) * slope0
+                + (u3 - u2) * slope1;
+
+    t = clamp(t, from, to);
+
+    // The speed is the derivative of the length, stay inside the interval.
+    for (auto step = 0; step < BEZIER_LENGTH_NEWTON_STEPS; ++step) {
+        auto error = lengths[lo] + partialLength(table, lo, from, t) - length;
+        auto speed = bezierSpeed(table, t);
+
+        if (fabsf(error) <= slack || speed <= 0.0f)
+            break;
+        t = clamp(t - error / speed, from, to);
+    }
+
+    return t;
+}
+
+BEZIER_LENGTH_DEF void bezierLengthsToParams(BezierLengthTable const *table, f32 const *lengths, u32 count, f32 *outT)
+{
+    for (u32 idx = 0; idx < count; ++idx)
+        outT[idx] = bezierLengthToParam(table, lengths[idx]);
+}
+
+BEZIER_LENGTH_DEF u32
+placeBezierMarkers(BezierLengthTable const *table,
+                   f32                      offset,
+                   f32                      spacing,
+                   u32                      capacity,
+                   Vec2                    *outPos,
+                   Vec2                    *outDir,
+                   Arena                   *scratch)
+{
+    auto total = bezierLength(table);
+
+    if (offset < 0.0f || offset > total || spacing <= 0.0f || capacity == 0)
+        return 0;
+
+    auto count = u32(fminf(floorf((total - offset) / spacing) + 1.0f, f32(capacity)));
+    auto mark  = arenaMark(scratch);
+    auto ts    = pushArray(scratch, f32, count);
+    defer(popArena(scratch, mark));
+
+    if (ts == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough scratch memory for %u markers.\n", count);
+        exit(EXIT_FAILURE);
+    }
+
+    // Lengths first, then turned into parameters in place.
+    for (u32 idx = 0; idx < count; ++idx)
+        ts[idx] = offset + f32(idx) * spacing;
+    bezierLengthsToParams(table, ts, count, ts);
+    evalBezierParams(table->curve.cp, ts, count, outPos);
+
+    if (outDir == nullptr)
+        return count;
+
+    auto chord = table->curve.cp[3] - table->curve.cp[0];
+
+    for (u32 idx = 0; idx < count; ++idx) {
+        auto dir   = evalBezierN(table->hodograph, ts[idx]);
+        auto lenSq = len_sq(dir);
+
+        // A cusp has no direction, fall back to the chord's.
+        if (lenSq <= 1e-12f) {
+            dir   = chord;
+            lenSq = len_sq(dir);
+        }
+        outDir[idx] = lenSq > 0.0f ? dir / sqrtf(lenSq) : vec2(1.0f, 0.0f);
+    }
+
+    return count;
+}
+
+BEZIER_LENGTH_DEF u32
+bezierDashParams(BezierLengthTable const *table,
+                 f32                      offset,
+                 f32                      dash,
+                 f32                      gap,
+                 u32                      capacity,
+                 f32                     *outT)
+{
+    auto total  = bezierLength(table);
+    auto period = dash + gap;
+
+    if (dash <= 0.0f || gap < 0.0f || total <= 0.0f || capacity == 0)
+        return 0;
+
+    // Start of the last dash to start at or before the curve.
+    auto start = -fmodf(offset, period);
+    auto count = u32(0);
+
+    if (start > 0.0f)
+        start -= period;
+
+    for (auto at = start; at < total && count < capacity; at += period) {
+        auto from = fmaxf(at, 0.0f);
+        auto to   = fminf(at + dash, total);
+
+        if (to > from) {
+            outT[2 * count + 0] = from;
+            outT[2 * count + 1] = to;
+            count += 1;
+        }
+    }
+
+    bezierLengthsToParams(table, outT, 2 * count, outT);
+
+    return count;
+}
+
+#endif // BEZIER_LENGTH_IMPLEMENTATION
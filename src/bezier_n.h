@@ -0,0 +1,287 @@
+#ifndef GUARD_INCLUDE_BEZIER_N_H
+#define GUARD_INCLUDE_BEZIER_N_H
+
+#include <math.h>
+
+#include "m3d.h"
+#include "common.h"
+
+/*
+ * Bezier curves of any degree fixed at compile time.  Scalar is the type
+ * of a control point, anything with + and - and a product with the
+ * parameter: f32 or f64 for one coordinate (as in BezierSoA), Vec2 for a
+ * point, Vec3 for a point of a rational curve (see RationalBezierN).
+ * Every routine is unrolled by template recursion over the number of
+ * points, no loop runs over the degree.
+ *
+ * Evaluation is de Casteljau with the operation order of lerp from m3d.h,
+ * so BezierN<3, f32> and BezierN<3, Vec2> give bit for bit the results of
+ * the batch evaluators in bezier_batch.h.
+ */
+template <i32 Degree, typename Scalar = Vec2>
+struct BezierN {
+    static_assert(Degree >= 0, "A bezier has at least one control point.");
+
+    static constexpr i32 POINTS = Degree + 1;
+
+    Scalar cp[Degree + 1];
+};
+
+using QuadraticBezier = BezierN<2>;
+using CubicBezier     = BezierN<3>;
+
+/*
+ * Parameter type for a control point type, f64 points are evaluated at
+ * f64 parameters, everything else at f32.
+ */
+template <typename Scalar> struct BezierParam      { typedef f32 Type; };
+template <>                struct BezierParam<f64> { typedef f64 Type; };
+
+template <typename Scalar, typename Param>
+inline Scalar bezierLerp(Param t, Scalar a, Scalar b)
+{
+    return ((1 - t) * a) + (t * b);
+}
+
+/*
+ * One de Casteljau step over Count + 1 points, out[i] is the point t of
+ * the way from in[i] to in[i + 1].
+ */
+template <i32 Count>
+struct BezierStep {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *in, Param t, Scalar *out) {
+        BezierStep<Count - 1>::apply(in, t, out);
+        out[Count - 1] = bezierLerp(t, in[Count - 1], in[Count]);
+    }
+};
+
+template <>
+struct BezierStep<0> {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *, Param, Scalar *) {}
+};
+
+/* Steps until one of Count points is left. */
+template <i32 Count>
+struct BezierReduce {
+    template <typename Scalar, typename Param>
+    static inline Scalar apply(Scalar const *pts, Param t) {
+        Scalar next[Count - 1];
+
+        BezierStep<Count - 1>::apply(pts, t, next);
+        return BezierReduce<Count - 1>::apply(next, t);
+    }
+};
+
+template <>
+struct BezierReduce<1> {
+    template <typename Scalar, typename Param>
+    static inline Scalar apply(Scalar const *pts, Param) {
+        return pts[0];
+    }
+};
+
+/*
+ * Every step's first point goes to left and its last point to right,
+ * which fill up from opposite ends.
+ */
+template <i32 Count>
+struct BezierSplit {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *pts, Param t, Scalar *left, Scalar *right) {
+        Scalar next[Count - 1];
+
+        *left  = pts[0];
+        *right = pts[Count - 1];
+        BezierStep<Count - 1>::apply(pts, t, next);
+        BezierSplit<Count - 1>::apply(next, t, left + 1, right - 1);
+    }
+};
+
+template <>
+struct BezierSplit<1> {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *pts, Param, Scalar *left, Scalar *right) {
+        *left  = pts[0];
+        *right = pts[0];
+    }
+};
+
+/* out[i] = scale * (in[i + 1] - in[i]) for the first Count differences. */
+template <i32 Count>
+struct BezierDifference {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *in, Param scale, Scalar *out) {
+        BezierDifference<Count - 1>::apply(in, scale, out);
+        out[Count - 1] = scale * (in[Count] - in[Count - 1]);
+    }
+};
+
+template <>
+struct BezierDifference<0> {
+    template <typename Scalar, typename Param>
+    static inline void apply(Scalar const *, Param, Scalar *) {}
+};
+
+/*
+ * Inner points of the curve of one degree higher, point i mixes in[i - 1]
+ * and in[i] by i / Points.
+ */
+template <i32 Index, i32 Points>
+struct BezierElevate {
+    template <typename Scalar>
+    static inline void apply(Scalar const *in, Scalar *out) {
+        typedef typename BezierParam<Scalar>::Type Param;
+
+        BezierElevate<Index - 1, Points>::apply(in, out);
+        out[Index] = bezierLerp(Param(Points - Index) / Param(Points), in[Index - 1], in[Index]);
+    }
+};
+
+template <i32 Points>
+struct BezierElevate<0, Points> {
+    template <typename Scalar>
+    static inline void apply(Scalar const *, Scalar *) {}
+};
+
+template <i32 Degree, typename Scalar>
+inline Scalar evalBezierN(BezierN<Degree, Scalar> const &curve, typename BezierParam<Scalar>::Type t)
+{
+    return BezierReduce<Degree + 1>::apply(curve.cp, t);
+}
+
+/*
+ * The derivative with respect to t, a curve of one degree lower.
+ */
+template <i32 Degree, typename Scalar>
+inline BezierN<Degree - 1, Scalar> bezierDerivative(BezierN<Degree, Scalar> const &curve)
+{
+    static_assert(Degree >= 1, "The derivative of a point has no control points.");
+
+    typedef typename BezierParam<Scalar>::Type Param;
+
+    auto hodograph = BezierN<Degree - 1, Scalar>{};
+
+    BezierDifference<Degree>::apply(curve.cp, Param(Degree), hodograph.cp);
+
+    return hodograph;
+}
+
+/*
+ * Split curve at t into the part before and the part after.
+ */
+template <i32 Degree, typename Scalar>
+inline void splitBezierN(BezierN<Degree, Scalar> const &curve,
+                         typename BezierParam<Scalar>::Type t,
+                         BezierN<Degree, Scalar> *left,
+                         BezierN<Degree, Scalar> *right)
+{
+    BezierSplit<Degree + 1>::apply(curve.cp, t, left->cp, right->cp + Degree);
+}
+
+/*
+ * The same curve with one more control point, a TrueType quadratic
+ * becomes a cubic for everything that only takes cubics.
+ */
+template <i32 Degree, typename Scalar>
+inline BezierN<Degree + 1, Scalar> elevateBezier(BezierN<Degree, Scalar> const &curve)
+{
+    auto higher = BezierN<Degree + 1, Scalar>{};
+
+    higher.cp[0]          = curve.cp[0];
+    higher.cp[Degree + 1] = curve.cp[Degree];
+    BezierElevate<Degree, Degree + 1>::apply(curve.cp, higher.cp);
+
+    return higher;
+}
+
+/*
+ * Rational curves are kept in homogeneous form, control point i with
+ * weight w is (w x, w y, w).  Evaluation, splitting and elevation are
+ * the polynomial ones on the three coordinates, the point on the curve
+ * is the projection of the result.  All weights 1 is the plain curve.
+ */
+template <i32 Degree>
+using RationalBezierN = BezierN<Degree, Vec3>;
+
+using RationalQuadratic = RationalBezierN<2>;
+using RationalCubic     = RationalBezierN<3>;
+
+/*
+ * Segments of at most a quarter turn keep the weights of conicArc above
+ * cos(45 degrees), far from the zero weight of a half turn.
+ */
+constexpr i32 BEZIER_CONIC_MAX_SEGMENTS = 4;
+
+inline Vec3 homogeneousPoint(Vec2 pt, f32 weight)
+{
+    return vec3(weight * pt.x, weight * pt.y, weight);
+}
+
+inline Vec2 projectPoint(Vec3 pt)
+{
+    return vec2(pt.x / pt.z, pt.y / pt.z);
+}
+
+template <i32 Degree>
+inline Vec2 evalRationalBezier(RationalBezierN<Degree> const &curve, f32 t)
+{
+    return projectPoint(evalBezierN(curve, t));
+}
+
+/*
+ * Direction of the tangent at t, not normalized and not the derivative,
+ * which also has a factor 1 / w(t)^2.
+ */
+template <i32 Degree>
+inline Vec2 rationalBezierTangent(RationalBezierN<Degree> const &curve, f32 t)
+{
+    auto pt    = evalBezierN(curve, t);
+    auto delta = evalBezierN(bezierDerivative(curve), t);
+
+    return vec2(pt.z * delta.x - pt.x * delta.z, pt.z * delta.y - pt.y * delta.z);
+}
+
+/*
+ * Exact arc of the ellipse with radii along the axes turned by rotation
+ * around center, from angle start over sweep radians (negative sweeps go
+ * clockwise, sweeps over a full turn are clamped).  Writes one rational
+ * quadratic per quarter turn, at most BEZIER_CONIC_MAX_SEGMENTS, to out
+ * and returns how many.  A circle is radii x == y.
+ */
+inline u32 conicArc(Vec2 center, Vec2 radii, f32 rotation, f32 start, f32 sweep, RationalQuadratic *out)
+{
+    sweep = clamp(sweep, -2.0f * PI, 2.0f * PI);
+
+    auto count  = u32(ceilf(fabsf(sweep) / (0.5f * PI) - 1e-4f));
+    auto cosRot = cosf(rotation);
+    auto sinRot = sinf(rotation);
+
+    if (count < 1)
+        count = 1;
+
+    auto step   = sweep / f32(count);
+    auto weight = cosf(0.5f * step);
+
+    // The point at angle of the ellipse, scaled from the center.
+    auto onEllipse = [&](f32 angle, f32 scale) {
+        auto x = scale * radii.x * cosf(angle);
+        auto y = scale * radii.y * sinf(angle);
+
+        return center + vec2(cosRot * x - sinRot * y, sinRot * x + cosRot * y);
+    };
+
+    for (u32 seg = 0; seg < count; ++seg) {
+        auto from = start + f32(seg) * step;
+
+        // The middle control point is where the end tangents meet.
+        out[seg].cp[0] = homogeneousPoint(onEllipse(from, 1.0f), 1.0f);
+        out[seg].cp[1] = homogeneousPoint(onEllipse(from + 0.5f * step, 1.0f / weight), weight);
+        out[seg].cp[2] = homogeneousPoint(onEllipse(from + step, 1.0f), 1.0f);
+    }
+
+    return count;
+}
+
+#endif // GUARD_INCLUDE_BEZIER_N_H
@@ -0,0 +1,583 @@
+#ifndef GUARD_INCLUDE_BEZIER_PATH_H
+#define GUARD_INCLUDE_BEZIER_PATH_H
+
+#ifdef BEZIER_PATH_STATIC
+    #define BEZIER_PATH_DEF static
+#else
+    #define BEZIER_PATH_DEF extern
+#endif
+
+#include <glad/glad.h>
+
+#include "m3d.h"
+#include "common.h"
+#include "render_state.h"
+#include "stream_buffer.h"
+
+/*
+ * Per segment flags.  The continuity flags are about the join with the
+ * segment before, for the first segment of a closed subpath that is the
+ * last one.
+ */
+enum BezierSegmentFlag : u8 {
+    BEZIER_SEGMENT_LINE    = 1 << 0,    // straight, tessellated as one step
+    BEZIER_SEGMENT_TANGENT = 1 << 1,    // G1, the handles around the join stay in line
+    BEZIER_SEGMENT_SMOOTH  = 1 << 2,    // C1, the handles around the join mirror each other
+};
+
+/*
+ * Points firstPoint to firstPoint + 3 * segmentCount of the path, its
+ * segments are firstSegment on.  The last point of a closed subpath is
+ * the same as its first.
+ */
+struct BezierSubpath {
+    u32  firstPoint;
+    u32  firstSegment;
+    u32  segmentCount;
+    bool isClosed;
+};
+
+/*
+ * Cubic segments that share their end points.  A subpath of N segments
+ * takes 3N + 1 points, segment n is points 3n to 3n + 3 of its subpath,
+ * the layout triangulateBezierFill and the batch evaluators take.
+ * Lines are stored as cubics with their handles at the thirds.
+ */
+struct BezierPath {
+    Vec2          *points;
+    u8            *segmentFlags;
+    BezierSubpath *subpaths;
+
+    u32 pointCount;
+    u32 segmentCount;
+    u32 subpathCount;
+
+    u32 pointCapacity;
+    u32 segmentCapacity;
+    u32 subpathCapacity;
+};
+
+/*
+ * A tessellated path, one line strip per subpath out of one buffer and
+ * drawn with one glMultiDrawArrays.
+ */
+struct BezierPathMesh {
+    GLuint  vao;
+    GLuint  vbo;
+    GLsizei vertexCount;
+    GLsizei gpuCapacity;
+
+    GLint   *firsts;
+    GLsizei *counts;
+    u32      stripCount;
+    u32      stripCapacity;
+};
+
+struct BezierPathShader {
+    GLuint programId;
+    GLuint MVP_uniform;
+    GLuint color_uniform;
+};
+
+BEZIER_PATH_DEF BezierPath makeBezierPath(u32 segmentCapacity);
+BEZIER_PATH_DEF void       freeBezierPath(BezierPath *path);
+BEZIER_PATH_DEF void       clearBezierPath(BezierPath *path);
+
+/*
+ * Path commands.  moveTo starts a new subpath, drawing before the first
+ * moveTo starts at the origin and drawing after a close starts again at
+ * the closed subpath's first point.  close draws a line back to the
+ * first point unless the subpath already ends there.
+ */
+BEZIER_PATH_DEF void bezierPathMoveTo(BezierPath *path, Vec2 pt);
+BEZIER_PATH_DEF void bezierPathLineTo(BezierPath *path, Vec2 pt);
+BEZIER_PATH_DEF void bezierPathCubicTo(BezierPath *path, Vec2 c1, Vec2 c2, Vec2 pt);
+BEZIER_PATH_DEF void bezierPathClose(BezierPath *path);
+
+/*
+ * Set the continuity flags of segment, BEZIER_SEGMENT_TANGENT or
+ * BEZIER_SEGMENT_SMOOTH or neither, and move the segment's first handle
+ * to satisfy them.
+ */
+BEZIER_PATH_DEF void setBezierPathContinuity(BezierPath *path, u32 segment, u8 continuity);
+
+/*
+ * Move point idx and keep the joins: an end point takes its handles
+ * along and a handle turns the handle across the join as the join's
+ * flags ask.  A handle of a line makes it a curve, a handle across from
+ * a line is left alone.
+ */
+BEZIER_PATH_DEF void moveBezierPathPoint(BezierPath *path, u32 idx, Vec2 pos);
+
+/*
+ * Most vertices tessellateBezierPath writes for path at segments steps
+ * per curve.
+ */
+BEZIER_PATH_DEF u32 bezierPathVertexBound(BezierPath const *path, u32 segments);
+
+/*
+ * Tessellate every curve of path into segments steps and every line into
+ * one, writing a single stream of vertices to out.  Shared end points are
+ * written once.  Subpath n is counts[n] vertices from firsts[n], which
+ * need room for path->subpathCount elements.  Returns the number of
+ * vertices written.
+ */
+BEZIER_PATH_DEF u32 tessellateBezierPath(BezierPath const *path,
+                                         u32               segments,
+                                         Vec2             *out,
+                                         GLint            *firsts,
+                                         GLsizei          *counts,
+                                         Arena            *scratch);
+
+BEZIER_PATH_DEF BezierPathMesh makeBezierPathMesh(u32 vertexCapacity);
+BEZIER_PATH_DEF void           freeBezierPathMesh(BezierPathMesh *mesh);
+
+/*
+ * Tessellate path and upload it.  Call again when path changes.
+ */
+BEZIER_PATH_DEF void loadBezierPath(BezierPathMesh   *mesh,
+                                    BezierPath const *path,
+                                    u32               segments,
+                                    StreamBuffer     *stream,
+                                    Arena            *scratch,
+                                    RenderState      *state);
+
+BEZIER_PATH_DEF void renderBezierPath(BezierPathMesh   *mesh,
+                                      BezierPathShader *shader,
+                                      RenderState      *state,
+                                      Mat4             *mvp,
+                                      Vec4              color);
+
+#endif // GUARD_INCLUDE_BEZIER_PATH_H
+
+
+#ifdef BEZIER_PATH_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+#include <SDL_log.h>
+
+#include "bezier_batch.h"
+
+static void *growPathArray(void *data, u32 *capacity, u32 needed, size_t size, char const *what)
+{
+    if (needed <= *capacity)
+        return data;
+
+    auto grown = *capacity > 0 ? *capacity : 1;
+
+    while (grown < needed)
+        grown *= 2;
+
+    auto result = realloc(data, grown * size);
+
+    if (result == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for %u path %s.\n", grown, what);
+        exit(EXIT_FAILURE);
+    }
+    *capacity = grown;
+
+    return result;
+}
+
+static void reserveBezierPath(BezierPath *path, u32 points, u32 segments, u32 subpaths)
+{
+    path->points = (Vec2*) growPathArray(path->points, &path->pointCapacity,
+                                         path->pointCount + points, sizeof(Vec2), "points");
+    path->segmentFlags = (u8*) growPathArray(path->segmentFlags, &path->segmentCapacity,
+                                             path->segmentCount + segments, sizeof(u8), "segments");
+    path->subpaths = (BezierSubpath*) growPathArray(path->subpaths, &path->subpathCapacity,
+                                                    path->subpathCount + subpaths,
+                                                    sizeof(BezierSubpath), "subpaths");
+}
+
+BEZIER_PATH_DEF BezierPath makeBezierPath(u32 segmentCapacity)
+{
+    auto path = BezierPath{};
+
+    reserveBezierPath(&path, 3 * segmentCapacity + 1, segmentCapacity, 1);
+
+    return path;
+}
+
+BEZIER_PATH_DEF void freeBezierPath(BezierPath *path)
+{
+    free(path->points);
+    free(path->segmentFlags);
+    free(path->subpaths);
+    *path = BezierPath{};
+}
+
+BEZIER_PATH_DEF void clearBezierPath(BezierPath *path)
+{
+    path->pointCount   = 0;
+    path->segmentCount = 0;
+    path->subpathCount = 0;
+}
+
+BEZIER_PATH_DEF void bezierPathMoveTo(BezierPath *path, Vec2 pt)
+{
+    if (path->subpathCount > 0) {
+        auto sub = &path->subpaths[path->subpathCount - 1];
+
+        // Moving twice in a row only keeps the last.
+        if (sub->segmentCount == 0) {
+            path->points[sub->firstPoint] = pt;
+            sub->isClosed = false;
+            return;
+        }
+    }
+
+    reserveBezierPath(path, 1, 0, 1);
+    path->subpaths[path->subpathCount++] = BezierSubpath{ path->pointCount, path->segmentCount, 0, false };
+    path->points[path->pointCount++]     = pt;
+}
+
+/* The subpath to draw on, started as the commands above describe. */
+static BezierSubpath *openSubpath(BezierPath *path)
+{
+    if (path->subpathCount == 0) {
+        bezierPathMoveTo(path, vec2(0.0f, 0.0f));
+    } else if (path->subpaths[path->subpathCount - 1].isClosed) {
+        bezierPathMoveTo(path, path->points[path->subpaths[path->subpathCount - 1].firstPoint]);
+    }
+
+    return &path->subpaths[path->subpathCount - 1];
+}
+
+static void appendSegment(BezierPath *path, Vec2 c1, Vec2 c2, Vec2 pt, u8 flags)
+{
+    // Opening a subpath may add a point, reserve after it.
+    auto sub = openSubpath(path);
+
+    reserveBezierPath(path, 3, 1, 0);
+
+    path->points[path->pointCount++] = c1;
+    path->points[path->pointCount++] = c2;
+    path->points[path->pointCount++] = pt;
+    path->segmentFlags[path->segmentCount++] = flags;
+    sub->segmentCount += 1;
+}
+
+BEZIER_PATH_DEF void bezierPathLineTo(BezierPath *path, Vec2 pt)
+{
+    openSubpath(path);
+
+    auto from = path->points[path->pointCount - 1];
+
+    appendSegment(path, lerp(1.0f / 3.0f, from, pt), lerp(2.0f / 3.0f, from, pt), pt, BEZIER_SEGMENT_LINE);
+}
+
+BEZIER_PATH_DEF void bezierPathCubicTo(BezierPath *path, Vec2 c1, Vec2 c2, Vec2 pt)
+{
+    appendSegment(path, c1, c2, pt, 0);
+}
+
+BEZIER_PATH_DEF void bezierPathClose(BezierPath *path)
+{
+    if (path->subpathCount == 0)
+        return;
+
+    auto sub   = &path->subpaths[path->subpathCount - 1];
+    auto first = path->points[sub->firstPoint];
+    auto last  = path->points[path->pointCount - 1];
+
+    if (sub->isClosed || sub->segmentCount == 0)
+        return;
+
+    if (first.x != last.x || first.y != last.y) {
+        bezierPathLineTo(path, first);
+        sub = &path->subpaths[path->subpathCount - 1];
+    }
+    sub->isClosed = true;
+}
+
+/* Last subpath whose first point (or segment) is at or before idx. */
+static BezierSubpath *findSubpath(BezierPath *path, u32 idx, bool isSegment)
+{
+    auto lo = u32(0);
+    auto hi = path->subpathCount;
+
+    while (hi - lo > 1) {
+        auto mid   = (lo + hi) / 2;
+        auto first = isSegment ? path->subpaths[mid].firstSegment : path->subpaths[mid].firstPoint;
+
+        if (first <= idx) lo = mid;
+        else              hi = mid;
+    }
+
+    return &path->subpaths[lo];
+}
+
+/* Put the handles of local segment seg of a line back on the thirds. */
+static void straightenSegment(BezierPath *path, BezierSubpath const *sub, u32 seg)
+{
+    if (!(path->segmentFlags[sub->firstSegment + seg] & BEZIER_SEGMENT_LINE))
+        return;
+
+    auto cp = path->points + sub->firstPoint + 3 * seg;
+
+    cp[1] = lerp(1.0f / 3.0f, cp[0], cp[3]);
+    cp[2] = lerp(2.0f / 3.0f, cp[0], cp[3]);
+}
+
+/*
+ * Joint at local point index joint of sub (a multiple of 3), the index of
+ * the segment starting there and the local indices of the handles before
+ * and after.  Returns false for the open ends, which have only one.
+ */
+static bool findJoin(BezierSubpath const *sub, u32 joint, u32 *segment, u32 *before, u32 *after)
+{
+    auto last = 3 * sub->segmentCount;
+
+    if (joint == 0 || joint == last) {
+        if (!sub->isClosed)
+            return false;
+
+        *segment = sub->firstSegment;
+        *before  = last - 1;
+        *after   = 1;
+        return true;
+    }
+
+    *segment = sub->firstSegment + joint / 3;
+    *before  = joint - 1;
+    *after   = joint + 1;
+    return true;
+}
+
+/*
+ * Turn the handle across the join from the handle at local index moved,
+ * as the join's continuity flags ask.
+ */
+static void keepJoin(BezierPath *path, BezierSubpath const *sub, u32 joint, u32 moved)
+{
+    auto segment = u32(0);
+    auto before  = u32(0);
+    auto after   = u32(0);
+
+    if (!findJoin(sub, joint, &segment, &before, &after))
+        return;
+
+    auto flags  = path->segmentFlags[segment];
+    auto other  = moved == after ? before : after;
+    auto pts    = path->points + sub->firstPoint;
+    auto center = pts[joint];
+
+    if (path->segmentFlags[sub->firstSegment + other / 3] & BEZIER_SEGMENT_LINE)
+        return;
+
+    if (flags & BEZIER_SEGMENT_SMOOTH) {
+        pts[other] = center + (center - pts[moved]);
+    } else if (flags & BEZIER_SEGMENT_TANGENT) {
+        auto arm    = pts[moved] - center;
+        auto armLen = sqrtf(len_sq(arm));
+
+        if (armLen > 0.0f)
+            pts[other] = center - sqrtf(len_sq(pts[other] - center)) / armLen * arm;
+    }
+}
+
+BEZIER_PATH_DEF void setBezierPathContinuity(BezierPath *path, u32 segment, u8 continuity)
+{
+    auto flags = path->segmentFlags[segment] & ~(BEZIER_SEGMENT_TANGENT | BEZIER_SEGMENT_SMOOTH);
+    auto sub   = findSubpath(path, segment, true);
+
+    path->segmentFlags[segment] = u8(flags | (continuity & (BEZIER_SEGMENT_TANGENT | BEZIER_SEGMENT_SMOOTH)));
+
+    // The handle before the join leads, the segment's first handle follows.
+    auto joint = 3 * (segment - sub->firstSegment);
+
+    if (joint == 0 && sub->isClosed)
+        keepJoin(path, sub, joint, 3 * sub->segmentCount - 1);
+    else if (joint > 0)
+        keepJoin(path, sub, joint, joint - 1);
+}
+
+BEZIER_PATH_DEF void moveBezierPathPoint(BezierPath *path, u32 idx, Vec2 pos)
+{
+    auto sub   = findSubpath(path, idx, false);
+    auto pts   = path->points + sub->firstPoint;
+    auto local = idx - sub->firstPoint;
+    auto last  = 3 * sub->segmentCount;
+
+    if (local % 3 == 0) {
+        auto delta = pos - pts[local];
+
+        pts[local] = pos;
+        if (local > 0)    pts[local - 1] = pts[local - 1] + delta;
+        if (local < last) pts[local + 1] = pts[local + 1] + delta;
+
+        // The ends of a closed subpath are one point.
+        if (sub->isClosed && (local == 0 || local == last)) {
+            auto twin = local == 0 ? last : 0;
+
+            pts[twin] = pos;
+            if (twin > 0)    pts[twin - 1] = pts[twin - 1] + delta;
+            if (twin < last) pts[twin + 1] = pts[twin + 1] + delta;
+        }
+
+        // Lines stay lines.
+        if (local > 0)    straightenSegment(path, sub, local / 3 - 1);
+        if (local < last) straightenSegment(path, sub, local / 3);
+        if (sub->isClosed && sub->segmentCount > 0) {
+            straightenSegment(path, sub, 0);
+            straightenSegment(path, sub, sub->segmentCount - 1);
+        }
+        return;
+    }
+
+    auto joint = local % 3 == 1 ? local - 1 : local + 1;
+
+    pts[local] = pos;
+    path->segmentFlags[sub->firstSegment + local / 3] &= u8(~BEZIER_SEGMENT_LINE);
+    keepJoin(path, sub, joint, local);
+}
+
+BEZIER_PATH_DEF u32 bezierPathVertexBound(BezierPath const *path, u32 segments)
+{
+    auto bound = path->subpathCount;
+
+    for (u32 seg = 0; seg < path->segmentCount; ++seg)
+        bound += (path->segmentFlags[seg] & BEZIER_SEGMENT_LINE) ? 1 : segments;
+
+    return bound;
+}
+
+BEZIER_PATH_DEF u32
+tessellateBezierPath(BezierPath const *path,
+                     u32               segments,
+                     Vec2             *out,
+                     GLint            *firsts,
+                     GLsizei          *counts,
+                     Arena            *scratch)
+{
+    if (segments < 1)
+        segments = 1;
+
+    auto mark   = arenaMark(scratch);
+    auto params = pushArray(scratch, f32, segments);
+    defer(popArena(scratch, mark));
+
+    if (params == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough scratch memory to tessellate a path.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (u32 step = 1; step < segments; ++step)
+        params[step] = f32(step) / f32(segments);
+
+    auto written = u32(0);
+
+    for (u32 idx = 0; idx < path->subpathCount; ++idx) {
+        auto sub = path->subpaths[idx];
+        auto cp  = path->points + sub.firstPoint;
+
+        firsts[idx]      = GLint(written);
+        out[written++]   = cp[0];
+
+        // Each segment writes its interior and its last point, the first is the one before.
+        for (u32 seg = 0; seg < sub.segmentCount; ++seg, cp += 3) {
+            if (!(path->segmentFlags[sub.firstSegment + seg] & BEZIER_SEGMENT_LINE) && segments > 1) {
+                evalBezierParams(cp, params + 1, segments - 1, out + written);
+                written += segments - 1;
+            }
+            out[written++] = cp[3];
+        }
+        counts[idx] = GLsizei(written - u32(firsts[idx]));
+    }
+
+    return written;
+}
+
+BEZIER_PATH_DEF BezierPathMesh makeBezierPathMesh(u32 vertexCapacity)
+{
+    auto mesh = BezierPathMesh{};
+
+    mesh.gpuCapacity = GLsizei(vertexCapacity > 0 ? vertexCapacity : 1);
+
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.gpuCapacity * sizeof(Vec2), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vec2), (GLvoid*) 0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    return mesh;
+}
+
+BEZIER_PATH_DEF void freeBezierPathMesh(BezierPathMesh *mesh)
+{
+    glDeleteBuffers(1, &mesh->vbo);
+    glDeleteVertexArrays(1, &mesh->vao);
+    free(mesh->firsts);
+    free(mesh->counts);
+    *mesh = BezierPathMesh{};
+}
+
+BEZIER_PATH_DEF void
+loadBezierPath(BezierPathMesh   *mesh,
+               BezierPath const *path,
+               u32               segments,
+               StreamBuffer     *stream,
+               Arena            *scratch,
+               RenderState      *state)
+{
+    constexpr u32 STRIDE = sizeof(Vec2);
+
+    auto firstsCapacity = mesh->stripCapacity;
+    auto countsCapacity = mesh->stripCapacity;
+
+    mesh->firsts = (GLint*) growPathArray(mesh->firsts, &firstsCapacity, path->subpathCount,
+                                          sizeof(GLint), "strips");
+    mesh->counts = (GLsizei*) growPathArray(mesh->counts, &countsCapacity, path->subpathCount,
+                                            sizeof(GLsizei), "strips");
+    mesh->stripCapacity = firstsCapacity;
+    mesh->stripCount    = path->subpathCount;
+
+    auto bound = bezierPathVertexBound(path, segments);
+
+    if (bound == 0) {
+        mesh->vertexCount = 0;
+        return;
+    }
+
+    auto verts = (Vec2*) beginStreamWrite(stream, mesh->vbo, 0, bound * STRIDE);
+    auto count = tessellateBezierPath(path, segments, verts, mesh->firsts, mesh->counts, scratch);
+
+    mesh->vertexCount = GLsizei(count);
+    if (GLsizei(count) > mesh->gpuCapacity) {
+        while (mesh->gpuCapacity < GLsizei(count))
+            mesh->gpuCapacity *= 2;
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        glBufferData(GL_ARRAY_BUFFER, mesh->gpuCapacity * STRIDE, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    endStreamWrite(stream, state, count * STRIDE);
+}
+
+BEZIER_PATH_DEF void
+renderBezierPath(BezierPathMesh   *mesh,
+                 BezierPathShader *shader,
+                 RenderState      *state,
+                 Mat4             *mvp,
+                 Vec4              color)
+{
+    if (mesh->vertexCount == 0)
+        return;
+
+    setCapability(state, GL_LINE_SMOOTH, false);
+    setLineWidth(state, 1.0f);
+    setProgram(state, shader->programId);
+    glUniformMatrix4fv(shader->MVP_uniform, 1, GL_FALSE, mvp->data);
+    glUniform4f(shader->color_uniform, color.r, color.g, color.b, color.a);
+    setVertexArray(state, mesh->vao);
+    glMultiDrawArrays(GL_LINE_STRIP, mesh->firsts, mesh->counts, GLsizei(mesh->stripCount));
+    setVertexArray(state, 0);
+}
+
+#endif // BEZIER_PATH_IMPLEMENTATION
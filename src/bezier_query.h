@@ -0,0 +1,593 @@
+#ifndef GUARD_INCLUDE_BEZIER_QUERY_H
+#define GUARD_INCLUDE_BEZIER_QUERY_H
+
+#ifdef BEZIER_QUERY_STATIC
+    #define BEZIER_QUERY_DEF static
+#else
+    #define BEZIER_QUERY_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier.h"
+#include "bezier_scene.h"
+
+#if !defined(BEZIER_NEAREST_SAMPLES)
+    #define BEZIER_NEAREST_SAMPLES 16
+#endif
+
+/*
+ * Point on a curve at parameter t, distance away from the query.
+ */
+struct BezierHit {
+    f32  t;
+    f32  distance;
+    Vec2 point;
+};
+
+/*
+ * A hit on curve index of a BezierScene, index is -1 for no hit.
+ */
+struct BezierSceneHit {
+    i32       index;
+    BezierHit hit;
+};
+
+struct BezierBounds {
+    Vec2 min;
+    Vec2 max;
+};
+
+/*
+ * Bounding volume hierarchy over the curves of a BezierScene.  Inner
+ * nodes have their children at first and first + 1, leaves hold count
+ * curves at items[first].  Children always come after their parent.
+ */
+struct BezierBvhNode {
+    BezierBounds bounds;
+    u32          first;
+    u32          count;     // 0 for inner nodes
+};
+
+struct BezierBvh {
+    BezierBvhNode *nodes;
+    u32            nodeCount;
+    u32           *items;       // dense curve indices
+    u32            itemCount;
+    BezierBounds  *curveBounds; // by dense curve index
+    u32            capacity;
+};
+
+/*
+ * Closest point to pos on the cubic cp.  The curve is sampled at
+ * BEZIER_NEAREST_SAMPLES + 1 uniform steps and every local minimum is
+ * refined with Newton's method on (B(t) - pos) . B'(t) = 0.
+ */
+BEZIER_QUERY_DEF BezierHit nearestPointOnCubic(Vec2 const *cp, Vec2 pos);
+BEZIER_QUERY_DEF BezierHit nearestPointOnBezier(Bezier const &bez, Vec2 pos);
+
+/*
+ * Closest curve of the scene that is at most maxDistance away from pos.
+ * Curves whose control point box is farther away than the best hit so
+ * far are skipped without evaluating them.
+ */
+BEZIER_QUERY_DEF BezierSceneHit nearestBezierInScene(BezierScene const *scene, Vec2 pos, f32 maxDistance);
+
+/*
+ * Exact bounds of the cubic cp, from the end points and the points
+ * where the derivative of either coordinate is zero.
+ */
+BEZIER_QUERY_DEF BezierBounds bezierBounds(Vec2 const *cp);
+
+/*
+ * World space box visible through mvp, which may only scale and
+ * translate x and y.
+ */
+BEZIER_QUERY_DEF BezierBounds clipBounds(Mat4 const *mvp);
+
+/*
+ * Build the hierarchy over every curve of scene, again after curves were
+ * added, removed or the scene compacted.  Leaves hold up to
+ * BEZIER_BVH_LEAF_SIZE curves.
+ */
+BEZIER_QUERY_DEF void buildBezierBvh(BezierBvh *bvh, BezierScene const *scene);
+BEZIER_QUERY_DEF void freeBezierBvh(BezierBvh *bvh);
+
+/*
+ * Recompute the bounds after control points moved.  The tree keeps its
+ * shape so its nodes overlap more the farther curves move, rebuild after large
+ * edits.
+ */
+BEZIER_QUERY_DEF void refitBezierBvh(BezierBvh *bvh, BezierScene const *scene);
+
+/*
+ * Write the dense index of every curve whose bounds overlap box to out,
+ * up to maxOut of them, and return how many overlap.
+ */
+BEZIER_QUERY_DEF u32 queryBezierBvh(BezierBvh const *bvh, BezierBounds box, u32 *out, u32 maxOut);
+
+/*
+ * nearestBezierInScene that only visits the subtrees within reach.
+ */
+BEZIER_QUERY_DEF BezierSceneHit nearestBezierInBvh(BezierBvh const   *bvh,
+                                                   BezierScene const *scene,
+                                                   Vec2               pos,
+                                                   f32                maxDistance);
+
+#endif // GUARD_INCLUDE_BEZIER_QUERY_H
+
+
+#ifdef BEZIER_QUERY_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+#include <SDL_log.h>
+
+#if !defined(BEZIER_BVH_LEAF_SIZE)
+    #define BEZIER_BVH_LEAF_SIZE 4
+#endif
+
+// Deep enough for a median split tree over 2^32 curves.
+constexpr i32 BEZIER_BVH_STACK = 64;
+
+/*
+ * Power basis of the cubic, B(t) = ((a t + b) t + c) t + d.
+ */
+struct CubicPoly {
+    Vec2 a, b, c, d;
+};
+
+static CubicPoly cubicPoly(Vec2 const *cp)
+{
+    auto poly = CubicPoly{};
+
+    poly.a = cp[3] - cp[0] + 3.0f * (cp[1] - cp[2]);
+    poly.b = 3.0f * (cp[2] - 2.0f * cp[1] + cp[0]);
+    poly.c = 3.0f * (cp[1] - cp[0]);
+    poly.d = cp[0];
+
+    return poly;
+}
+
+static Vec2 evalPoly(CubicPoly const &poly, f32 t)
+{
+    return ((poly.a * t + poly.b) * t + poly.c) * t + poly.d;
+}
+
+static f32 refineNearest(CubicPoly const &poly, Vec2 pos, f32 t)
+{
+    constexpr i32 MAX_STEPS = 8;
+
+    for (auto step = 0; step < MAX_STEPS; ++step) {
+        auto diff = evalPoly(poly, t) - pos;
+        auto d1   = (3.0f * poly.a * t + 2.0f * poly.b) * t + poly.c;
+        auto d2   = 6.0f * poly.a * t + 2.0f * poly.b;
+        auto num  = dot(diff, d1);
+        auto den  = dot(d1, d1) + dot(diff, d2);
+
+        if (den <= 0.0f)
+            break;
+
+        auto next = clamp(t - num / den, 0.0f, 1.0f);
+
+        if (fabsf(next - t) < 1e-6f) {
+            t = next;
+            break;
+        }
+        t = next;
+    }
+
+    return t;
+}
+
+BEZIER_QUERY_DEF BezierHit nearestPointOnCubic(Vec2 const *cp, Vec2 pos)
+{
+    constexpr i32 SAMPLES = BEZIER_NEAREST_SAMPLES;
+
+    auto poly = cubicPoly(cp);
+    f32  distSq[SAMPLES + 1];
+
+    for (auto idx = 0; idx <= SAMPLES; ++idx)
+        distSq[idx] = len_sq(evalPoly(poly, f32(idx) / f32(SAMPLES)) - pos);
+
+    auto best   = BezierHit{};
+    auto bestSq = distSq[0];
+
+    best.t     = 0.0f;
+    best.point = cp[0];
+    if (distSq[SAMPLES] < bestSq) {
+        bestSq     = distSq[SAMPLES];
+        best.t     = 1.0f;
+        best.point = cp[3];
+    }
+
+    for (auto idx = 0; idx <= SAMPLES; ++idx) {
+        auto isMin = (idx == 0       || distSq[idx] <= distSq[idx - 1])
+                  && (idx == SAMPLES || distSq[idx] <= distSq[idx + 1]);
+
+        if (!isMin)
+            continue;
+
+        auto t  = refineNearest(poly, pos, f32(idx) / f32(SAMPLES));
+        auto pt = evalPoly(poly, t);
+        auto sq = len_sq(pt - pos);
+
+        if (sq < bestSq) {
+            bestSq     = sq;
+            best.t     = t;
+            best.point = pt;
+        }
+    }
+
+    best.distance = sqrtf(bestSq);
+    return best;
+}
+
+BEZIER_QUERY_DEF BezierHit nearestPointOnBezier(Bezier const &bez, Vec2 pos)
+{
+    return nearestPointOnCubic(bez.cp, pos);
+}
+
+BEZIER_QUERY_DEF BezierSceneHit nearestBezierInScene(BezierScene const *scene, Vec2 pos, f32 maxDistance)
+{
+    auto& curves = scene->curves;
+    auto  result = BezierSceneHit{ -1, BezierHit{} };
+    auto  bestSq = maxDistance * maxDistance;
+
+    for (u32 idx = 0; idx < scene->count; ++idx) {
+        // The curve is inside the box of its control points.
+        auto minX = min_of(min_of(curves.x[0][idx], curves.x[1][idx]), min_of(curves.x[2][idx], curves.x[3][idx]));
+        auto maxX = max_of(max_of(curves.x[0][idx], curves.x[1][idx]), max_of(curves.x[2][idx], curves.x[3][idx]));
+        auto minY = min_of(min_of(curves.y[0][idx], curves.y[1][idx]), min_of(curves.y[2][idx], curves.y[3][idx]));
+        auto maxY = max_of(max_of(curves.y[0][idx], curves.y[1][idx]), max_of(curves.y[2][idx], curves.y[3][idx]));
+        auto dx   = max_of(max_of(minX - pos.x, pos.x - maxX), 0.0f);
+        auto dy   = max_of(max_of(minY - pos.y, pos.y - maxY), 0.0f);
+
+        if (dx * dx + dy * dy > bestSq || scene->slots[idx] == BEZIER_SCENE_HOLE)
+            continue;
+
+        Vec2 cp[4];
+        for (auto i = 0; i < 4; ++i)
+            cp[i] = vec2(curves.x[i][idx], curves.y[i][idx]);
+
+        auto hit = nearestPointOnCubic(cp, pos);
+
+        if (hit.distance * hit.distance <= bestSq) {
+            bestSq       = hit.distance * hit.distance;
+            result.index = i32(idx);
+            result.hit   = hit;
+        }
+    }
+
+    return result;
+}
+
+static void growBounds(BezierBounds *box, Vec2 pt)
+{
+    box->min = min_of(box->min, pt);
+    box->max = max_of(box->max, pt);
+}
+
+static BezierBounds unionBounds(BezierBounds a, BezierBounds b)
+{
+    return BezierBounds{ min_of(a.min, b.min), max_of(a.max, b.max) };
+}
+
+static bool isOverlapping(BezierBounds a, BezierBounds b)
+{
+    return a.min.x <= b.max.x && b.min.x <= a.max.x
+        && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+static f32 boundsDistanceSq(BezierBounds box, Vec2 pos)
+{
+    auto dx = max_of(max_of(box.min.x - pos.x, pos.x - box.max.x), 0.0f);
+    auto dy = max_of(max_of(box.min.y - pos.y, pos.y - box.max.y), 0.0f);
+
+    return dx * dx + dy * dy;
+}
+
+/*
+ * Roots in (0, 1) of a t^2 + b t + c, written to roots.  Returns the count.
+ */
+static i32 unitQuadraticRoots(f32 a, f32 b, f32 c, f32 *roots)
+{
+    constexpr f32 EPSILON = 1e-12f;
+
+    auto count = 0;
+    auto push  = [&](f32 t) {
+        if (t > 0.0f && t < 1.0f)
+            roots[count++] = t;
+    };
+
+    if (fabsf(a) < EPSILON) {
+        if (fabsf(b) > EPSILON)
+            push(-c / b);
+        return count;
+    }
+
+    auto disc = b * b - 4.0f * a * c;
+
+    if (disc < 0.0f)
+        return count;
+
+    // Avoids the cancellation of -b + sqrt(disc) when b is large.
+    auto q = -0.5f * (b + (b < 0.0f ? -sqrtf(disc) : sqrtf(disc)));
+
+    push(q / a);
+    if (q != 0.0f)
+        push(c / q);
+
+    return count;
+}
+
+BEZIER_QUERY_DEF BezierBounds bezierBounds(Vec2 const *cp)
+{
+    auto box  = BezierBounds{ min_of(cp[0], cp[3]), max_of(cp[0], cp[3]) };
+    auto poly = cubicPoly(cp);
+
+    // B'(t) = 3 a t^2 + 2 b t + c with the power basis coefficients.
+    for (auto axis = 0; axis < 2; ++axis) {
+        f32  roots[2];
+        auto count = unitQuadraticRoots(3.0f * poly.a[axis], 2.0f * poly.b[axis], poly.c[axis], roots);
+
+        for (auto idx = 0; idx < count; ++idx)
+            growBounds(&box, evalPoly(poly, roots[idx]));
+    }
+
+    return box;
+}
+
+BEZIER_QUERY_DEF BezierBounds clipBounds(Mat4 const *mvp)
+{
+    auto cornerA = vec2((-1.0f - mvp->at(0, 3)) / mvp->at(0, 0), (-1.0f - mvp->at(1, 3)) / mvp->at(1, 1));
+    auto cornerB = vec2(( 1.0f - mvp->at(0, 3)) / mvp->at(0, 0), ( 1.0f - mvp->at(1, 3)) / mvp->at(1, 1));
+
+    return BezierBounds{ min_of(cornerA, cornerB), max_of(cornerA, cornerB) };
+}
+
+static Vec2 boundsCenter(BezierBounds box)
+{
+    return 0.5f * (box.min + box.max);
+}
+
+/*
+ * Reorder items so the one with the mid-th smallest center along axis
+ * is at mid, smaller ones before it and larger ones after it.
+ */
+static void selectMedian(u32 *items, u32 count, u32 mid, i32 axis, BezierBounds const *bounds)
+{
+    auto key = [&](u32 idx) { return boundsCenter(bounds[items[idx]])[axis]; };
+    auto swap = [&](u32 a, u32 b) { auto tmp = items[a]; items[a] = items[b]; items[b] = tmp; };
+
+    auto lo = u32(0);
+    auto hi = count - 1;
+
+    while (lo < hi) {
+        auto pivot = key(lo + (hi - lo) / 2);
+        auto i     = lo;
+        auto j     = hi;
+
+        while (i <= j) {
+            while (key(i) < pivot) ++i;
+            while (key(j) > pivot) --j;
+            if (i <= j) {
+                swap(i, j);
+                ++i;
+                if (j == 0) break;
+                --j;
+            }
+        }
+
+        if (mid <= j)      hi = j;
+        else if (mid >= i) lo = i;
+        else               break;
+    }
+}
+
+static void computeCurveBounds(BezierBvh *bvh, BezierScene const *scene)
+{
+    auto& curves = scene->curves;
+
+    for (u32 item = 0; item < bvh->itemCount; ++item) {
+        auto idx = bvh->items[item];
+        Vec2 cp[4];
+
+        for (auto i = 0; i < 4; ++i)
+            cp[i] = vec2(curves.x[i][idx], curves.y[i][idx]);
+        bvh->curveBounds[idx] = bezierBounds(cp);
+    }
+}
+
+static void fitNodes(BezierBvh *bvh)
+{
+    for (auto node = i32(bvh->nodeCount) - 1; node >= 0; --node) {
+        auto& nd = bvh->nodes[node];
+
+        if (nd.count == 0) {
+            nd.bounds = unionBounds(bvh->nodes[nd.first].bounds, bvh->nodes[nd.first + 1].bounds);
+            continue;
+        }
+
+        nd.bounds = bvh->curveBounds[bvh->items[nd.first]];
+        for (auto item = nd.first + 1; item < nd.first + nd.count; ++item)
+            nd.bounds = unionBounds(nd.bounds, bvh->curveBounds[bvh->items[item]]);
+    }
+}
+
+BEZIER_QUERY_DEF void buildBezierBvh(BezierBvh *bvh, BezierScene const *scene)
+{
+    if (scene->count > bvh->capacity) {
+        auto capacity = scene->count;
+
+        free(bvh->nodes);
+        free(bvh->items);
+        free(bvh->curveBounds);
+        bvh->nodes       = (BezierBvhNode*) malloc(2 * capacity * sizeof(BezierBvhNode));
+        bvh->items       = (u32*) malloc(capacity * sizeof(u32));
+        bvh->curveBounds = (BezierBounds*) malloc(capacity * sizeof(BezierBounds));
+        bvh->capacity    = capacity;
+
+        if (bvh->nodes == nullptr || bvh->items == nullptr || bvh->curveBounds == nullptr) {
+            SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                            "Not enough memory for a bvh over %u curves.\n", capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    bvh->itemCount = 0;
+    for (u32 idx = 0; idx < scene->count; ++idx) {
+        if (scene->slots[idx] != BEZIER_SCENE_HOLE)
+            bvh->items[bvh->itemCount++] = idx;
+    }
+
+    bvh->nodeCount = 0;
+    if (bvh->itemCount == 0)
+        return;
+
+    computeCurveBounds(bvh, scene);
+
+    bvh->nodes[bvh->nodeCount++] = BezierBvhNode{ BezierBounds{}, 0, bvh->itemCount };
+
+    // Nodes are split in creation order, so children always follow their parent.
+    for (u32 node = 0; node < bvh->nodeCount; ++node) {
+        auto first = bvh->nodes[node].first;
+        auto count = bvh->nodes[node].count;
+
+        if (count <= BEZIER_BVH_LEAF_SIZE)
+            continue;
+
+        auto centers = BezierBounds{ boundsCenter(bvh->curveBounds[bvh->items[first]]),
+                                     boundsCenter(bvh->curveBounds[bvh->items[first]]) };
+
+        for (auto item = first + 1; item < first + count; ++item)
+            growBounds(&centers, boundsCenter(bvh->curveBounds[bvh->items[item]]));
+
+        auto extent = centers.max - centers.min;
+        auto axis   = extent.x >= extent.y ? 0 : 1;
+        auto half   = count / 2;
+
+        selectMedian(bvh->items + first, count, half, axis, bvh->curveBounds);
+
+        auto left = bvh->nodeCount;
+
+        bvh->nodes[left]     = BezierBvhNode{ BezierBounds{}, first,        half };
+        bvh->nodes[left + 1] = BezierBvhNode{ BezierBounds{}, first + half, count - half };
+        bvh->nodeCount      += 2;
+
+        bvh->nodes[node].first = left;
+        bvh->nodes[node].count = 0;
+    }
+
+    fitNodes(bvh);
+}
+
+BEZIER_QUERY_DEF void freeBezierBvh(BezierBvh *bvh)
+{
+    free(bvh->nodes);
+    free(bvh->items);
+    free(bvh->curveBounds);
+    *bvh = BezierBvh{};
+}
+
+BEZIER_QUERY_DEF void refitBezierBvh(BezierBvh *bvh, BezierScene const *scene)
+{
+    computeCurveBounds(bvh, scene);
+    fitNodes(bvh);
+}
+
+BEZIER_QUERY_DEF u32 queryBezierBvh(BezierBvh const *bvh, BezierBounds box, u32 *out, u32 maxOut)
+{
+    u32  stack[BEZIER_BVH_STACK];
+    auto top   = 0;
+    auto found = u32(0);
+
+    if (bvh->nodeCount == 0)
+        return 0;
+
+    stack[top++] = 0;
+    while (top > 0) {
+        auto& node = bvh->nodes[stack[--top]];
+
+        if (!isOverlapping(node.bounds, box))
+            continue;
+
+        if (node.count == 0) {
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+            continue;
+        }
+
+        for (auto item = node.first; item < node.first + node.count; ++item) {
+            auto idx = bvh->items[item];
+
+            if (!isOverlapping(bvh->curveBounds[idx], box))
+                continue;
+            if (found < maxOut)
+                out[found] = idx;
+            ++found;
+        }
+    }
+
+    return found;
+}
+
+BEZIER_QUERY_DEF BezierSceneHit
+nearestBezierInBvh(BezierBvh const   *bvh,
+                   BezierScene const *scene,
+                   Vec2               pos,
+                   f32                maxDistance)
+{
+    u32  stack[BEZIER_BVH_STACK];
+    auto top    = 0;
+    auto result = BezierSceneHit{ -1, BezierHit{} };
+    auto bestSq = maxDistance * maxDistance;
+
+    if (bvh->nodeCount == 0)
+        return result;
+
+    stack[top++] = 0;
+    while (top > 0) {
+        auto& node = bvh->nodes[stack[--top]];
+
+        if (boundsDistanceSq(node.bounds, pos) > bestSq)
+            continue;
+
+        if (node.count == 0) {
+            // Visit the nearer child first so the farther one is more likely skipped.
+            auto near = node.first;
+            auto far  = node.first + 1;
+
+            if (boundsDistanceSq(bvh->nodes[far].bounds, pos) < boundsDistanceSq(bvh->nodes[near].bounds, pos)) {
+                near = node.first + 1;
+                far  = node.first;
+            }
+            stack[top++] = far;
+            stack[top++] = near;
+            continue;
+        }
+
+        for (auto item = node.first; item < node.first + node.count; ++item) {
+            auto idx = bvh->items[item];
+
+            if (boundsDistanceSq(bvh->curveBounds[idx], pos) > bestSq)
+                continue;
+
+            Vec2 cp[4];
+            for (auto i = 0; i < 4; ++i)
+                cp[i] = bezierControlPoint(scene, idx, i);
+
+            auto hit = nearestPointOnCubic(cp, pos);
+
+            if (hit.distance * hit.distance <= bestSq) {
+                bestSq       = hit.distance * hit.distance;
+                result.index = i32(idx);
+                result.hit   = hit;
+            }
+        }
+    }
+
+    return result;
+}
+
+#endif // BEZIER_QUERY_IMPLEMENTATION
@@ -0,0 +1,311 @@
+#ifndef GUARD_INCLUDE_BEZIER_SCENE_H
+#define GUARD_INCLUDE_BEZIER_SCENE_H
+
+#ifdef BEZIER_SCENE_STATIC
+    #define BEZIER_SCENE_DEF static
+#else
+    #define BEZIER_SCENE_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+#include "bezier_batch.h"
+
+/*
+ * Refers to a curve of a BezierScene.  A handle stays valid until its
+ * curve is removed, also across compaction, and a removed curve's
+ * handle is never valid again (until the generation wraps at 2^32).
+ */
+struct BezierHandle {
+    u32 slot;
+    u32 generation;
+};
+
+/*
+ * Many curves kept as separate contiguous arrays so passes over the
+ * whole scene only touch the data they need.  Curves are in draw order
+ * at dense indices [0, count).  Removing a curve leaves a hole (its slot
+ * is BEZIER_SCENE_HOLE) so the other indices and tessellation ranges
+ * stay put, compactBezierScene closes the holes.
+ */
+struct BezierScene {
+    BezierSoA  curves;          // control points, curves.count == count
+    Vec4      *colors;
+    f32       *widths;
+    u32       *firstVertex;     // tessellation range in the scene's vertices
+    u32       *vertexCount;
+    u32       *slots;           // dense index -> slot
+    u32        count;
+    u32        capacity;
+    u32        liveCount;
+
+    u32       *dense;           // slot -> dense index, or the next free slot
+    u32       *generations;
+    u32        slotCount;
+    u32        slotCapacity;
+    u32        freeSlot;
+};
+
+constexpr u32 BEZIER_SCENE_HOLE = 0xffffffff;
+
+BEZIER_SCENE_DEF BezierScene makeBezierScene(u32 capacity);
+BEZIER_SCENE_DEF void        freeBezierScene(BezierScene *scene);
+
+BEZIER_SCENE_DEF BezierHandle addBezier(BezierScene *scene, Vec2 const *cp, Vec4 color, f32 width);
+BEZIER_SCENE_DEF bool         removeBezier(BezierScene *scene, BezierHandle handle);
+
+/*
+ * Dense index of the curve or -1 if handle is stale.
+ */
+BEZIER_SCENE_DEF i32 bezierIndex(BezierScene const *scene, BezierHandle handle);
+
+/*
+ * Handle of the curve at index, one that is never valid for a hole.
+ */
+BEZIER_SCENE_DEF BezierHandle bezierHandle(BezierScene const *scene, u32 index);
+
+BEZIER_SCENE_DEF Vec2 bezierControlPoint(BezierScene const *scene, u32 index, i32 cp);
+BEZIER_SCENE_DEF void setBezierControlPoint(BezierScene *scene, u32 index, i32 cp, Vec2 pos);
+
+/*
+ * Close the holes left by removed curves, keeping the draw order.
+ * Handles stay valid, dense indices and tessellation ranges don't.
+ */
+BEZIER_SCENE_DEF void compactBezierScene(BezierScene *scene);
+
+/*
+ * Write segments + 1 points for every curve to out, curve after curve,
+ * and set the tessellation ranges.  Holes get an empty range.  out needs
+ * room for count * (segments + 1) points.  Returns the number of points
+ * written.
+ */
+BEZIER_SCENE_DEF u32 tessellateBezierScene(BezierScene *scene, u32 segments, Vec2 *out, Arena *scratch);
+
+#endif // GUARD_INCLUDE_BEZIER_SCENE_H
+
+
+#ifdef BEZIER_SCENE_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <SDL_log.h>
+
+static void growSceneArray(void **array, size_t elementSize, u32 capacity)
+{
+    auto grown = realloc(*array, capacity * elementSize);
+
+    if (grown == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for a scene of %u curves.\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    *array = grown;
+}
+
+static void growCurves(BezierScene *scene, u32 capacity)
+{
+    for (auto cp = 0; cp < 4; ++cp) {
+        growSceneArray((void**) &scene->curves.x[cp], sizeof(f32), capacity);
+        growSceneArray((void**) &scene->curves.y[cp], sizeof(f32), capacity);
+    }
+    growSceneArray((void**) &scene->colors,      sizeof(Vec4), capacity);
+    growSceneArray((void**) &scene->widths,      sizeof(f32),  capacity);
+    growSceneArray((void**) &scene->firstVertex, sizeof(u32),  capacity);
+    growSceneArray((void**) &scene->vertexCount, sizeof(u32),  capacity);
+    growSceneArray((void**) &scene->slots,       sizeof(u32),  capacity);
+    scene->capacity = capacity;
+}
+
+static void growSlots(BezierScene *scene, u32 capacity)
+{
+    growSceneArray((void**) &scene->dense,       sizeof(u32), capacity);
+    growSceneArray((void**) &scene->generations, sizeof(u32), capacity);
+    scene->slotCapacity = capacity;
+}
+
+BEZIER_SCENE_DEF BezierScene makeBezierScene(u32 capacity)
+{
+    auto scene = BezierScene{};
+
+    if (capacity == 0)
+        capacity = 1;
+
+    growCurves(&scene, capacity);
+    growSlots(&scene, capacity);
+    scene.freeSlot = BEZIER_SCENE_HOLE;
+
+    return scene;
+}
+
+BEZIER_SCENE_DEF void freeBezierScene(BezierScene *scene)
+{
+    for (auto cp = 0; cp < 4; ++cp) {
+        free(scene->curves.x[cp]);
+        free(scene->curves.y[cp]);
+    }
+    free(scene->colors);
+    free(scene->widths);
+    free(scene->firstVertex);
+    free(scene->vertexCount);
+    free(scene->slots);
+    free(scene->dense);
+    free(scene->generations);
+    *scene = BezierScene{};
+}
+
+BEZIER_SCENE_DEF BezierHandle addBezier(BezierScene *scene, Vec2 const *cp, Vec4 color, f32 width)
+{
+    if (scene->count == scene->capacity)
+        growCurves(scene, scene->capacity * 2);
+
+    auto slot = scene->freeSlot;
+
+    if (slot != BEZIER_SCENE_HOLE) {
+        scene->freeSlot = scene->dense[slot];
+    } else {
+        if (scene->slotCount == scene->slotCapacity)
+            growSlots(scene, scene->slotCapacity * 2);
+        slot = scene->slotCount++;
+        scene->generations[slot] = 0;
+    }
+
+    auto idx = scene->count++;
+
+    for (auto i = 0; i < 4; ++i) {
+        scene->curves.x[i][idx] = cp[i].x;
+        scene->curves.y[i][idx] = cp[i].y;
+    }
+    scene->curves.count      = scene->count;
+    scene->colors[idx]       = color;
+    scene->widths[idx]       = width;
+    scene->firstVertex[idx]  = 0;
+    scene->vertexCount[idx]  = 0;
+    scene->slots[idx]        = slot;
+    scene->dense[slot]       = idx;
+    scene->liveCount        += 1;
+
+    return BezierHandle{ slot, scene->generations[slot] };
+}
+
+BEZIER_SCENE_DEF i32 bezierIndex(BezierScene const *scene, BezierHandle handle)
+{
+    if (handle.slot >= scene->slotCount || scene->generations[handle.slot] != handle.generation)
+        return -1;
+
+    auto idx = scene->dense[handle.slot];
+
+    // A free slot holds the next free slot, which never points back at it.
+    if (idx >= scene->count || scene->slots[idx] != handle.slot)
+        return -1;
+
+    return i32(idx);
+}
+
+BEZIER_SCENE_DEF bool removeBezier(BezierScene *scene, BezierHandle handle)
+{
+    auto idx = bezierIndex(scene, handle);
+
+    if (idx < 0)
+        return false;
+
+    scene->slots[idx]       = BEZIER_SCENE_HOLE;
+    scene->vertexCount[idx] = 0;
+    scene->liveCount       -= 1;
+
+    scene->generations[handle.slot] += 1;
+    scene->dense[handle.slot]        = scene->freeSlot;
+    scene->freeSlot                  = handle.slot;
+
+    return true;
+}
+
+BEZIER_SCENE_DEF BezierHandle bezierHandle(BezierScene const *scene, u32 index)
+{
+    auto slot = scene->slots[index];
+
+    if (slot == BEZIER_SCENE_HOLE)
+        return BezierHandle{ BEZIER_SCENE_HOLE, 0 };
+
+    return BezierHandle{ slot, scene->generations[slot] };
+}
+
+BEZIER_SCENE_DEF Vec2 bezierControlPoint(BezierScene const *scene, u32 index, i32 cp)
+{
+    return vec2(scene->curves.x[cp][index], scene->curves.y[cp][index]);
+}
+
+BEZIER_SCENE_DEF void setBezierControlPoint(BezierScene *scene, u32 index, i32 cp, Vec2 pos)
+{
+    scene->curves.x[cp][index] = pos.x;
+    scene->curves.y[cp][index] = pos.y;
+}
+
+BEZIER_SCENE_DEF void compactBezierScene(BezierScene *scene)
+{
+    auto to = u32(0);
+
+    for (u32 from = 0; from < scene->count; ++from) {
+        auto slot = scene->slots[from];
+
+        if (slot == BEZIER_SCENE_HOLE)
+            continue;
+
+        if (to != from) {
+            for (auto cp = 0; cp < 4; ++cp) {
+                scene->curves.x[cp][to] = scene->curves.x[cp][from];
+                scene->curves.y[cp][to] = scene->curves.y[cp][from];
+            }
+            scene->colors[to]      = scene->colors[from];
+            scene->widths[to]      = scene->widths[from];
+            scene->firstVertex[to] = 0;
+            scene->vertexCount[to] = 0;
+            scene->slots[to]       = slot;
+            scene->dense[slot]     = to;
+        }
+        ++to;
+    }
+
+    scene->count        = to;
+    scene->curves.count = to;
+}
+
+BEZIER_SCENE_DEF u32 tessellateBezierScene(BezierScene *scene, u32 segments, Vec2 *out, Arena *scratch)
+{
+    auto count = scene->count;
+    auto mark  = arenaMark(scratch);
+    auto t     = pushArray(scratch, f32, count);
+    auto outX  = pushArray(scratch, f32, count);
+    auto outY  = pushArray(scratch, f32, count);
+    defer(popArena(scratch, mark));
+
+    if (t == nullptr || outX == nullptr || outY == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough scratch memory to tessellate %u curves.\n", count);
+        exit(EXIT_FAILURE);
+    }
+
+    auto stride = segments + 1;
+
+    for (u32 idx = 0; idx < count; ++idx) {
+        auto isHole = scene->slots[idx] == BEZIER_SCENE_HOLE;
+
+        scene->firstVertex[idx] = idx * stride;
+        scene->vertexCount[idx] = isHole ? 0 : stride;
+    }
+
+    // One step for every curve at a time, the batch evaluator works across curves.
+    for (u32 seg = 0; seg <= segments; ++seg) {
+        auto param = f32(seg) / f32(segments);
+
+        for (u32 idx = 0; idx < count; ++idx)
+            t[idx] = param;
+
+        evalBezierCurves(&scene->curves, t, outX, outY);
+
+        for (u32 idx = 0; idx < count; ++idx)
+            out[idx * stride + seg] = vec2(outX[idx], outY[idx]);
+    }
+
+    return count * stride;
+}
+
+#endif // BEZIER_SCENE_IMPLEMENTATION
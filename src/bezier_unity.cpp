@@ -7,6 +7,14 @@
 #include "m3d.h"
 #undef M3D_IMPLEMENTATION
 
+#define RENDER_STATE_IMPLEMENTATION
+#include "render_state.h"
+#undef RENDER_STATE_IMPLEMENTATION
+
+#define STREAM_BUFFER_IMPLEMENTATION
+#include "stream_buffer.h"
+#undef STREAM_BUFFER_IMPLEMENTATION
+
 #define GRID_IMPLEMENTATION
 #include "grid.h"
 #undef GRID_IMPLEMENTATION
@@ -19,7 +27,50 @@
 #include "font.h"
 #undef FONT_IMPLEMENTATION
 
+#define BEZIER_BATCH_IMPLEMENTATION
+#include "bezier_batch.h"
+#undef BEZIER_BATCH_IMPLEMENTATION
+
+#define BEZIER_LENGTH_IMPLEMENTATION
+#include "bezier_length.h"
+#undef BEZIER_LENGTH_IMPLEMENTATION
+
+#define BEZIER_SCENE_IMPLEMENTATION
+#include "bezier_scene.h"
+#undef BEZIER_SCENE_IMPLEMENTATION
+
+#define STROKE_IMPLEMENTATION
+#include "stroke.h"
+#undef STROKE_IMPLEMENTATION
+
 #define BEZIER_IMPLEMENTATION
 #include "bezier.h"
 #undef BEZIER_IMPLEMENTATION
 
+#define BEZIER_QUERY_IMPLEMENTATION
+#include "bezier_query.h"
+#undef BEZIER_QUERY_IMPLEMENTATION
+
+#define BEZIER_INTERSECT_IMPLEMENTATION
+#include "bezier_intersect.h"
+#undef BEZIER_INTERSECT_IMPLEMENTATION
+
+#define BEZIER_FILL_IMPLEMENTATION
+#include "bezier_fill.h"
+#undef BEZIER_FILL_IMPLEMENTATION
+
+#define BEZIER_PATH_IMPLEMENTATION
+#include "bezier_path.h"
+#undef BEZIER_PATH_IMPLEMENTATION
+
+#define BEZIER_INSTANCED_IMPLEMENTATION
+#include "bezier_instanced.h"
+#undef BEZIER_INSTANCED_IMPLEMENTATION
+
+#define POINT_GRID_IMPLEMENTATION
+#include "point_grid.h"
+#undef POINT_GRID_IMPLEMENTATION
+
+#define BENCH_IMPLEMENTATION
+#include "bench.h"
+#undef BENCH_IMPLEMENTATION
@@ -2,6 +2,8 @@
 #define GUARD_COMMON_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
 
 typedef uint8_t  u8;
 typedef uint16_t u16;
@@ -40,4 +42,63 @@ privDefer<F> defer_func(F f) {
 #define DEFER_3(x)    DEFER_2(x, __COUNTER__)
 #define defer(code)   auto DEFER_3(_defer_) = defer_func([&](){code;})
 
+
+/*
+ * Bump allocator for scratch memory.  Nothing is freed on its own,
+ * resetArena frees everything and popArena everything pushed after a
+ * mark, so scratch is usually taken as
+ *
+ *     auto mark = arenaMark(arena);
+ *     defer(popArena(arena, mark));
+ *
+ * highWater is the most that was ever asked for at once, including
+ * pushes that didn't fit, so it tells how large the arena should be.
+ */
+struct Arena {
+    u8    *base;
+    size_t size;
+    size_t used;
+    size_t highWater;
+};
+
+inline Arena makeArena(size_t size)
+{
+    auto arena = Arena{};
+
+    arena.base = (u8*) malloc(size);
+    if (arena.base != nullptr)
+        arena.size = size;
+
+    return arena;
+}
+
+inline void freeArena(Arena *arena)
+{
+    free(arena->base);
+    *arena = Arena{};
+}
+
+/*
+ * Returns nullptr if size doesn't fit.
+ */
+inline void *pushSize(Arena *arena, size_t size, size_t align = 16)
+{
+    auto start = (arena->used + align - 1) & ~(align - 1);
+    auto end   = start + size;
+
+    if (end > arena->highWater)
+        arena->highWater = end;
+    if (end > arena->size)
+        return nullptr;
+
+    arena->used = end;
+    return arena->base + start;
+}
+
+#define pushArray(arena, type, count) ((type*) pushSize((arena), (count) * sizeof(type), alignof(type)))
+
+inline size_t arenaMark(Arena const *arena)        { return arena->used; }
+inline void   popArena(Arena *arena, size_t mark)  { arena->used = mark; }
+inline void   resetArena(Arena *arena)             { arena->used = 0; }
+
 #endif GUARD_COMMON_H
@@ -0,0 +1,407 @@
+/*
+ * Golden image test of the curve fill.  Renders outlines headless through
+ * EGL on Mesa's surfaceless platform (llvmpipe without a GPU) into a
+ * framebuffer object, at 1x, 4x, 32x and 256x zoom around a point on the
+ * outline, and compares every pixel with an even-odd ray cast against
+ * the exact cubics.  Pixels the outline passes within FILL_TEST_EDGE
+ * pixels of may go either way, any other mismatch fails the test and
+ * the frame and its reference are written out as PPM files.
+ *
+ * Run with LIBGL_ALWAYS_SOFTWARE=1 to force llvmpipe.
+ */
+#include <SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <glad.c>
+
+#include "m3d.h"
+#include "gl_util.h"
+#include "render_state.h"
+#include "stream_buffer.h"
+#include "bezier_fill.h"
+#include "common.h"
+
+char const *VTX_FILL_SHADER =
+#include "shaders/vtxFill.glsl"
+"";
+
+char const *FRAG_FILL_SHADER =
+#include "shaders/fragFill.glsl"
+"";
+
+constexpr i32 FILL_TEST_SIZE       = 256;  // pixels on a side
+constexpr f32 FILL_TEST_EDGE       = 1.5f; // pixels around the outline that aren't compared
+constexpr u32 FILL_TEST_MAX_CURVES = 4;
+constexpr u32 FILL_TEST_RANDOM     = 24;   // random outlines after the fixed ones
+
+struct FillTestCase {
+    char const *name;
+    u32         curveCount;
+    Vec2        cp[3 * FILL_TEST_MAX_CURVES + 1];
+};
+
+/* Outlines that aren't closed are closed with a line, as triangulateBezierFill does. */
+static FillTestCase const FILL_TEST_CASES[] = {
+    { "demo curve",  1, { {120.0f, 160.0f}, {35.0f, 200.0f}, {220.0f, 260.0f}, {220.0f, 40.0f} } },
+    { "loop",        1, { {50.0f, 50.0f}, {350.0f, 350.0f}, {-50.0f, 350.0f}, {250.0f, 50.0f} } },
+    { "cusp",        1, { {50.0f, 50.0f}, {250.0f, 250.0f}, {50.0f, 250.0f}, {250.0f, 50.0f} } },
+    { "serpentine",  1, { {50.0f, 50.0f}, {300.0f, 50.0f}, {0.0f, 250.0f}, {250.0f, 250.0f} } },
+    { "quadratic",   1, { {50.0f, 50.0f}, {150.0f, 250.0f}, {200.0f, 250.0f}, {300.0f, 50.0f} } },
+    { "straight",    2, { {50.0f, 50.0f}, {150.0f, 100.0f}, {250.0f, 150.0f}, {350.0f, 200.0f},
+                          {300.0f, 300.0f}, {100.0f, 300.0f}, {50.0f, 50.0f} } },
+    { "two loops",   2, { {50.0f, 150.0f}, {300.0f, 400.0f}, {300.0f, -100.0f}, {50.0f, 150.0f},
+                          {-200.0f, 400.0f}, {-200.0f, -100.0f}, {50.0f, 150.0f} } },
+};
+
+/* Same sequence on every platform, unlike rand. */
+static f32 testRandom(u32 *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return f32(*state >> 8) / 16777216.0f;
+}
+
+static f64 cubicAt(f64 p0, f64 p1, f64 p2, f64 p3, f64 t)
+{
+    auto u = 1.0 - t;
+
+    return u * u * u * p0 + 3.0 * u * u * t * p1 + 3.0 * u * t * t * p2 + t * t * t * p3;
+}
+
+/*
+ * Crossings of the ray from (x, y) towards +x with one cubic, counted
+ * half-open in y so shared end points count once.  The curve is cut where
+ * y(t) turns and every monotone piece crossing y is bisected.
+ */
+static u32 rayCrossings(Vec2 const *cp, f64 x, f64 y)
+{
+    f64 const ys[4] = { cp[0].y, cp[1].y, cp[2].y, cp[3].y };
+    f64 const xs[4] = { cp[0].x, cp[1].x, cp[2].x, cp[3].x };
+
+    // y'(t) / 3 = a t^2 + b t + c
+    auto a = -ys[0] + 3.0 * ys[1] - 3.0 * ys[2] + ys[3];
+    auto b = 2.0 * (ys[0] - 2.0 * ys[1] + ys[2]);
+    auto c = ys[1] - ys[0];
+
+    f64 cuts[4] = { 0.0 };
+    u32 cutCount = 1;
+
+    if (fabs(a) > 1e-12) {
+        auto disc = b * b - 4.0 * a * c;
+
+        if (disc > 0.0) {
+            auto root = sqrt(disc);
+            auto t0   = (-b - root) / (2.0 * a);
+            auto t1   = (-b + root) / (2.0 * a);
+
+            if (t0 > t1) { auto tmp = t0; t0 = t1; t1 = tmp; }
+            if (t0 > 0.0 && t0 < 1.0) cuts[cutCount++] = t0;
+            if (t1 > 0.0 && t1 < 1.0) cuts[cutCount++] = t1;
+        }
+    } else if (fabs(b) > 1e-12) {
+        auto t0 = -c / b;
+
+        if (t0 > 0.0 && t0 < 1.0) cuts[cutCount++] = t0;
+    }
+    cuts[cutCount++] = 1.0;
+
+    auto crossings = u32(0);
+
+    for (u32 idx = 0; idx + 1 < cutCount; ++idx) {
+        auto lo  = cuts[idx];
+        auto hi  = cuts[idx + 1];
+        auto yLo = idx == 0 ? ys[0] : cubicAt(ys[0], ys[1], ys[2], ys[3], lo);
+        auto yHi = idx + 2 == cutCount ? ys[3] : cubicAt(ys[0], ys[1], ys[2], ys[3], hi);
+
+        if ((yLo > y) == (yHi > y))
+            continue;
+
+        auto isRising = yHi > yLo;
+
+        for (auto step = 0; step < 60; ++step) {
+            auto mid = 0.5 * (lo + hi);
+
+            if ((cubicAt(ys[0], ys[1], ys[2], ys[3], mid) > y) == isRising) hi = mid;
+            else                                                           lo = mid;
+        }
+
+        if (cubicAt(xs[0], xs[1], xs[2], xs[3], 0.5 * (lo + hi)) > x)
+            ++crossings;
+    }
+
+    return crossings;
+}
+
+static bool isInside(FillTestCase const *test, f64 x, f64 y)
+{
+    auto crossings = u32(0);
+    auto cp        = test->cp;
+    auto first     = cp[0];
+    auto last      = cp[3 * test->curveCount];
+
+    for (u32 curve = 0; curve < test->curveCount; ++curve)
+        crossings += rayCrossings(cp + 3 * curve, x, y);
+
+    if (first.x != last.x || first.y != last.y) {
+        Vec2 const line[4] = { last, lerp(1.0f / 3.0f, last, first), lerp(2.0f / 3.0f, last, first), first };
+
+        crossings += rayCrossings(line, x, y);
+    }
+
+    return crossings % 2 == 1;
+}
+
+static void writePPM(char const *path, u8 const *rgba)
+{
+    auto file = fopen(path, "wb");
+
+    if (file == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Can't write %s.\n", path);
+        return;
+    }
+    defer(fclose(file));
+
+    fprintf(file, "P6 %d %d 255\n", FILL_TEST_SIZE, FILL_TEST_SIZE);
+    for (auto y = FILL_TEST_SIZE - 1; y >= 0; --y) {
+        for (auto x = 0; x < FILL_TEST_SIZE; ++x)
+            fwrite(rgba + 4 * (y * FILL_TEST_SIZE + x), 1, 3, file);
+    }
+}
+
+/*
+ * Render test at zoom and return the number of pixels away from the
+ * outline that disagree with the ray cast.
+ */
+static u32 runFillCase(FillTestCase const *test,
+                       f32                 zoom,
+                       BezierFill         *fill,
+                       BezierFillShader   *shader,
+                       StreamBuffer       *stream,
+                       RenderState        *state,
+                       u8                 *pixels,
+                       u8                 *reference)
+{
+    constexpr f32 SIZE = f32(FILL_TEST_SIZE);
+
+    // Zoom in on a point of the outline so it crosses the view at every zoom.
+    auto cp     = test->cp;
+    auto center = evalBezierN(CubicBezier{ { cp[0], cp[1], cp[2], cp[3] } }, 0.37f);
+    auto mvp    = orthoGL(0.0f, SIZE, 0.0f, SIZE, 0.0f, 1.0f)
+                * translate(0.5f * SIZE, 0.5f * SIZE, 0.0f)
+                * scale(zoom, zoom, 1.0f)
+                * translate(-center.x, -center.y, 0.0f);
+
+    loadBezierFill(fill, cp, test->curveCount, stream, state);
+
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    renderBezierFill(fill, shader, state, &mvp, vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    fenceStreamBuffer(stream);
+    glReadPixels(0, 0, FILL_TEST_SIZE, FILL_TEST_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    Vec2 const offsets[] = { {1.0f, 0.0f}, {-1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, -1.0f},
+                             {0.7071f, 0.7071f}, {-0.7071f, 0.7071f}, {0.7071f, -0.7071f}, {-0.7071f, -0.7071f} };
+
+    auto mismatches = u32(0);
+
+    for (auto y = 0; y < FILL_TEST_SIZE; ++y) {
+        for (auto x = 0; x < FILL_TEST_SIZE; ++x) {
+            auto px       = f64(center.x) + (x + 0.5 - 0.5 * SIZE) / zoom;
+            auto py       = f64(center.y) + (y + 0.5 - 0.5 * SIZE) / zoom;
+            auto isFilled = isInside(test, px, py);
+            auto row      = FILL_TEST_SIZE - 1 - y; // orthoGL puts y = 0 on top
+            auto ref      = reference + 4 * (row * FILL_TEST_SIZE + x);
+            auto isDrawn  = pixels[4 * (row * FILL_TEST_SIZE + x)] < 128;
+
+            ref[0] = ref[1] = ref[2] = isFilled ? 0 : 255;
+            ref[3] = 255;
+
+            if (isDrawn == isFilled)
+                continue;
+
+            // Only a miss if the outline is farther than FILL_TEST_EDGE away.
+            auto isNearEdge = false;
+
+            for (auto idx = 0; idx < ARRAY_COUNT(offsets) && !isNearEdge; ++idx) {
+                auto ox = px + FILL_TEST_EDGE * offsets[idx].x / zoom;
+                auto oy = py + FILL_TEST_EDGE * offsets[idx].y / zoom;
+
+                isNearEdge = isInside(test, ox, oy) != isFilled;
+            }
+
+            if (!isNearEdge)
+                ++mismatches;
+        }
+    }
+
+    return mismatches;
+}
+
+static bool makeHeadlessContext()
+{
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "EGL has no eglGetPlatformDisplayEXT.\n");
+        return false;
+    }
+
+    auto display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "No surfaceless EGL display.\n");
+        return false;
+    }
+
+    EGLint const attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,       3,
+        EGL_CONTEXT_MINOR_VERSION,       3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+
+    eglBindAPI(EGL_OPENGL_API);
+
+    auto context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Failed to create a GL 3.3 core context: 0x%x\n", eglGetError());
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Failed to load GL functions.\n");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!makeHeadlessContext())
+        return EXIT_FAILURE;
+
+    SDL_Log("Renderer: %s", glGetString(GL_RENDERER));
+
+    // The fill needs a stencil buffer, no multisampling.
+    GLuint fbo;
+    GLuint renderbuffers[2];
+
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(2, renderbuffers);
+    defer(glDeleteFramebuffers(1, &fbo));
+    defer(glDeleteRenderbuffers(2, renderbuffers));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FILL_TEST_SIZE, FILL_TEST_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, FILL_TEST_SIZE, FILL_TEST_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glViewport(0, 0, FILL_TEST_SIZE, FILL_TEST_SIZE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "The test framebuffer is incomplete.\n");
+        return EXIT_FAILURE;
+    }
+
+    auto vtxFill  = glCreateShader(GL_VERTEX_SHADER);
+    auto fragFill = glCreateShader(GL_FRAGMENT_SHADER);
+    auto fillPrgm = glCreateProgram();
+
+    if (!util::buildShader(vtxFill,  VTX_FILL_SHADER))  return EXIT_FAILURE;
+    if (!util::buildShader(fragFill, FRAG_FILL_SHADER)) return EXIT_FAILURE;
+    glAttachShader(fillPrgm, vtxFill);
+    glAttachShader(fillPrgm, fragFill);
+    if (!util::linkProgram(fillPrgm)) return EXIT_FAILURE;
+    glDeleteShader(vtxFill);
+    glDeleteShader(fragFill);
+    defer(glDeleteProgram(fillPrgm));
+
+    auto shader = BezierFillShader{};
+
+    shader.programId     = fillPrgm;
+    shader.MVP_uniform   = glGetUniformLocation(fillPrgm, "MVP");
+    shader.color_uniform = glGetUniformLocation(fillPrgm, "FillColor");
+
+    // The same state main leaves the fill to deal with.
+    auto state = makeRenderState();
+
+    setCapability(&state, GL_CULL_FACE, true);
+    glFrontFace(GL_CW);
+
+    auto stream = makeStreamBuffer(1024 * 1024);
+    auto fill   = makeBezierFill(FILL_TEST_MAX_CURVES);
+    defer(freeStreamBuffer(&stream));
+    defer(freeBezierFill(&fill));
+
+    constexpr u32 PIXEL_BYTES = 4 * FILL_TEST_SIZE * FILL_TEST_SIZE;
+
+    auto pixels    = (u8*) malloc(PIXEL_BYTES);
+    auto reference = (u8*) malloc(PIXEL_BYTES);
+    defer(free(pixels));
+    defer(free(reference));
+
+    if (pixels == nullptr || reference == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "Not enough memory for the test images.\n");
+        return EXIT_FAILURE;
+    }
+
+    f32 const zooms[] = { 1.0f, 4.0f, 32.0f, 256.0f };
+
+    auto fixedCount = u32(ARRAY_COUNT(FILL_TEST_CASES));
+    auto failed     = u32(0);
+    auto seed       = u32(12345);
+
+    for (u32 idx = 0; idx < fixedCount + FILL_TEST_RANDOM; ++idx) {
+        auto test = FillTestCase{};
+
+        if (idx < fixedCount) {
+            test = FILL_TEST_CASES[idx];
+        } else {
+            // Closed outlines of one to three random curves.
+            test.name       = "random";
+            test.curveCount = 1 + (idx - fixedCount) % 3;
+            for (u32 pt = 0; pt < 3 * test.curveCount; ++pt)
+                test.cp[pt] = vec2(50.0f + 300.0f * testRandom(&seed), 50.0f + 300.0f * testRandom(&seed));
+            test.cp[3 * test.curveCount] = test.cp[0];
+        }
+
+        for (auto zoom : zooms) {
+            auto mismatches = runFillCase(&test, zoom, &fill, &shader, &stream, &state, pixels, reference);
+
+            if (mismatches == 0)
+                continue;
+
+            char path[64];
+
+            snprintf(path, sizeof(path), "fill_%u_%gx.ppm", idx, zoom);
+            writePPM(path, pixels);
+            snprintf(path, sizeof(path), "fill_%u_%gx_reference.ppm", idx, zoom);
+            writePPM(path, reference);
+
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "%s outline %u at %gx: %u pixels differ from the ray cast.\n",
+                         test.name, idx, zoom, mismatches);
+            ++failed;
+        }
+    }
+
+    auto runs = (fixedCount + FILL_TEST_RANDOM) * u32(ARRAY_COUNT(zooms));
+
+    if (glGetError() != GL_NO_ERROR) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "The fill raised a GL error.\n");
+        ++failed;
+    }
+
+    SDL_Log("fill: %u of %u renders match the ray cast", runs - failed, runs);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
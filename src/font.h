@@ -24,14 +24,15 @@ struct Font {
 
 /*
  * Fill the data memory of font with the characters from fontFile.  A
- * temporary bitmap is created and loaded into GPU memory as a texture
- * with the texture ID from font (the ID must have been previously generated).
+ * temporary bitmap is created on scratch and loaded into GPU memory as a
+ * texture with the texture ID from font (the ID must have been previously
+ * generated).
  *
  * Returns 0 on error.  Returns a positive number on success and a negative
  * number for the number of characters of font data that can fit into the
  * allocated bitmap (you would take the absolute value of the negative number).
  */
-FONT_DEF int fillFontData(char const *fontFile, Font *font);
+FONT_DEF int fillFontData(char const *fontFile, Font *font, Arena *scratch);
 
 #endif // GUARD_INCLUDE_FONT_H
 
@@ -43,7 +44,7 @@ FONT_DEF int fillFontData(char const *fontFile, Font *font);
 #include <SDL_log.h>
 #include <glad/glad.h>
 
-FONT_DEF int fillFontData(char const *fontFile, Font *font)
+FONT_DEF int fillFontData(char const *fontFile, Font *font, Arena *scratch)
 {
     auto log = [=](char const *fmt) -> int {
         SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, fmt, fontFile);
@@ -64,8 +65,12 @@ FONT_DEF int fillFontData(char const *fontFile, Font *font)
     if (fseek(file, 0, SEEK_SET))
         return log("Failed to seek beginning of file %s.\n");
 
-    auto ttfBuf = (u8*) malloc(fileSz);
-    defer(free(ttfBuf));
+    auto mark = arenaMark(scratch);
+    defer(popArena(scratch, mark));
+
+    auto ttfBuf = pushArray(scratch, u8, fileSz);
+    if (ttfBuf == nullptr)
+        return log("Not enough scratch memory to read file %s.\n");
 
     if (fread(ttfBuf, 1, fileSz, file) < fileSz)
         return log("Could not read file %s.\n");
@@ -78,8 +83,9 @@ FONT_DEF int fillFontData(char const *fontFile, Font *font)
         ++bmPow;
 
     auto bmDim  = 1 << bmPow;
-    auto bitmap = (u8*) malloc(bmDim * bmDim);
-    defer(free(bitmap));
+    auto bitmap = pushArray(scratch, u8, bmDim * bmDim);
+    if (bitmap == nullptr)
+        return log("Not enough scratch memory for the bitmap of file %s.\n");
 
     auto result = stbtt_BakeFontBitmap(ttfBuf,
                                        0,
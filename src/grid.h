@@ -11,12 +11,35 @@
 
 #include "m3d.h"
 #include "common.h"
+#include "render_state.h"
 
+#if !defined(GRID_MAX_LEVELS)
+    #define GRID_MAX_LEVELS 8
+#endif
+
+#if !defined(GRID_MIN_PIXELS)
+    #define GRID_MIN_PIXELS 8.0f    // closest grid lines are allowed to get on screen
+#endif
+
+/*
+ * The grid and tick lines are stored as levels of detail where level n
+ * has a spacing of spacing * 5^n.  A level only holds the lines that
+ * aren't in a coarser level.  Each level is split into four runs of
+ * lines (horizontal positive, horizontal negative, vertical positive and
+ * vertical negative) sorted by distance from the axis so only the visible
+ * lines have to be drawn.
+ */
 struct LineGrid {
     GLuint  vao[3];
     GLuint  vbo[3];
     GLsizei indexCount[3];
     Vec4    lineColors[3];
+
+    f32     spacing;
+    i32     levelCount;
+    GLint   levelFirst[GRID_MAX_LEVELS];    // first vertex of the level
+    GLsizei levelLines[GRID_MAX_LEVELS];    // lines in one run of the level
+    i32     levelMaxLine[GRID_MAX_LEVELS];  // farthest line from the axis in spacings of the level
 };
 
 struct LineGridShader {
@@ -25,8 +48,37 @@ struct LineGridShader {
     GLuint lineColor_uniform;
 };
 
-GRID_DEF LineGrid makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor);
-GRID_DEF void     renderLineGrid(LineGrid* grid, LineGridShader* program, Mat4* mvp);
+/*
+ * Grid that is computed per pixel in the fragment shader from a single
+ * full-screen triangle.  It has no vertex data and no edges.
+ */
+struct ProceduralGrid {
+    GLuint vao;
+    f32    spacing;
+    f32    tickLength;
+    Vec4   lineColors[3];
+};
+
+struct ProceduralGridShader {
+    GLuint programId;
+    GLuint inverseMVP_uniform;
+    GLuint viewport_uniform;
+    GLuint spacing_uniform;
+    GLuint tickLength_uniform;
+    GLuint gridColor_uniform;
+    GLuint tickColor_uniform;
+    GLuint axisColor_uniform;
+};
+
+GRID_DEF LineGrid makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor, Arena *scratch);
+GRID_DEF void     renderLineGrid(LineGrid* grid, LineGridShader* program, RenderState* state, Mat4* mvp, Vec2 viewport);
+
+GRID_DEF ProceduralGrid makeProceduralGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor);
+GRID_DEF void           renderProceduralGrid(ProceduralGrid*       grid,
+                                             ProceduralGridShader* program,
+                                             RenderState*          state,
+                                             Mat4*                 mvp,
+                                             Vec2                  viewport);
 
 #endif // GUARD_INCLUDE_ELEMENTS_H
 
@@ -35,54 +87,97 @@ GRID_DEF void     renderLineGrid(LineGrid* grid, LineGridShader* program, Mat4*
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 #include <SDL_log.h>
 
+/*
+ * Inverse of a transform that only scales and translates x and y, which
+ * is all the screen matrices do.  inverse() can't be used here because it
+ * gives up on the tiny determinants of zoomed out views.
+ */
+static Mat4 inverseScaleTranslate(Mat4 const &m)
+{
+    auto inv = identity();
+
+    inv.at(0, 0) = 1.0f / m.at(0, 0);
+    inv.at(1, 1) = 1.0f / m.at(1, 1);
+    inv.at(0, 3) = -m.at(0, 3) / m.at(0, 0);
+    inv.at(1, 3) = -m.at(1, 3) / m.at(1, 1);
+
+    return inv;
+}
+
+/*
+ * Write the lines of one level and return one past the last f32 written.
+ * Every fifth line is skipped unless this is the coarsest level.
+ */
+static f32* writeGridLevel(f32* out, f32 levelSpacing, i32 maxLine, bool isTop, f32 lo, f32 hi)
+{
+    for (auto run = 0; run < 4; ++run) {
+        for (auto lineNum = 1; lineNum <= maxLine; ++lineNum) {
+            if (!isTop && lineNum % 5 == 0)
+                continue;
+
+            auto pos = f32(lineNum) * levelSpacing * ((run & 1) ? -1.0f : 1.0f);
+
+            if (run < 2) { // horizontal
+                out[0] = lo;  out[1] = pos;
+                out[2] = hi;  out[3] = pos;
+            } else {       // vertical
+                out[0] = pos; out[1] = hi;
+                out[2] = pos; out[3] = lo;
+            }
+            out += 4;
+        }
+    }
+
+    return out;
+}
+
 GRID_DEF LineGrid
-makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor)
+makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor, Arena *scratch)
 {
-    auto grid        = LineGrid{};
-    auto lineCnt     = size_t(1000); // per one side of an axis
-    auto axisCnt     = 4;
-    auto f32PerLine  = 4;
-    auto lineByteCnt = lineCnt * axisCnt * f32PerLine * sizeof(f32);
-    auto lines       = (f32*) malloc(lineByteCnt);
+    auto grid       = LineGrid{};
+    auto lineCnt    = i32(1000); // per one side of an axis
+    auto axisCnt    = 4;
+    auto f32PerLine = 4;
+    auto totalLines = i32(0);
+
+    grid.spacing = spacing;
+
+    for (auto step = 1; lineCnt / step >= 1 && grid.levelCount < GRID_MAX_LEVELS; step *= 5) {
+        auto level  = grid.levelCount++;
+        auto maxLn  = lineCnt / step;
+        auto isTop  = lineCnt / (step * 5) < 1 || grid.levelCount == GRID_MAX_LEVELS;
+        auto lines  = isTop ? maxLn : maxLn - maxLn / 5;
+
+        grid.levelFirst[level]   = totalLines * axisCnt * 2;
+        grid.levelLines[level]   = lines;
+        grid.levelMaxLine[level] = maxLn;
+        totalLines += lines;
+    }
+
+    auto lineByteCnt = size_t(totalLines) * axisCnt * f32PerLine * sizeof(f32);
+    auto mark        = arenaMark(scratch);
+    auto lines       = (f32*) pushSize(scratch, lineByteCnt);
 
     if (lines == nullptr) {
         SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
                         "Not enough memory to generate a line grid.\n");
         exit(EXIT_FAILURE);
     }
-    defer(free(lines));
+    defer(popArena(scratch, mark));
 
     glGenVertexArrays(3, grid.vao);
     glGenBuffers(3, grid.vbo);
 
     // Ignore the center line for each axis and generate all the other grid lines.
     auto endPt = lineCnt * spacing;
+    auto out   = lines;
 
-    for (auto idx = 0, lineNum = 1; lineNum <= lineCnt; idx += 16, lineNum++)
-    {
-        // horizontal positive
-        lines[idx + 0] = -endPt;
-        lines[idx + 1] = f32(lineNum) * spacing;
-        lines[idx + 2] = endPt;
-        lines[idx + 3] = f32(lineNum) * spacing;
-        // horizontal negative
-        lines[idx + 4] = -endPt;
-        lines[idx + 5] = -f32(lineNum) * spacing;
-        lines[idx + 6] = endPt;
-        lines[idx + 7] = -f32(lineNum) * spacing;
-
-        // vertical positive
-        lines[idx + 8]  = f32(lineNum) * spacing;
-        lines[idx + 9]  = endPt;
-        lines[idx + 10] = f32(lineNum) * spacing;
-        lines[idx + 11] = -endPt;
-        // vertical negative
-        lines[idx + 12] = -f32(lineNum) * spacing;
-        lines[idx + 13] = endPt;
-        lines[idx + 14] = -f32(lineNum) * spacing;
-        lines[idx + 15] = -endPt;
+    for (auto level = 0, step = 1; level < grid.levelCount; ++level, step *= 5) {
+        auto isTop = level == grid.levelCount - 1;
+        out = writeGridLevel(out, spacing * step, grid.levelMaxLine[level], isTop, -endPt, endPt);
     }
 
     glBindVertexArray(grid.vao[0]);
@@ -94,29 +189,11 @@ makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor)
 
     // Generate the tick marks on the gird lines.
     auto tickPt = 5.0f;
-    for (auto idx = 0, lineNum = 1; lineNum <= lineCnt; idx += 16, lineNum++)
-    {
-        // horizontal positive
-        lines[idx + 0] = -tickPt;
-        lines[idx + 1] = f32(lineNum) * spacing;
-        lines[idx + 2] = tickPt;
-        lines[idx + 3] = f32(lineNum) * spacing;
-        // horizontal negative
-        lines[idx + 4] = -tickPt;
-        lines[idx + 5] = -f32(lineNum) * spacing;
-        lines[idx + 6] = tickPt;
-        lines[idx + 7] = -f32(lineNum) * spacing;
-
-        // vertical positive
-        lines[idx + 8]  = f32(lineNum) * spacing;
-        lines[idx + 9]  = tickPt;
-        lines[idx + 10] = f32(lineNum) * spacing;
-        lines[idx + 11] = -tickPt;
-        // vertical negative
-        lines[idx + 12] = -f32(lineNum) * spacing;
-        lines[idx + 13] = tickPt;
-        lines[idx + 14] = -f32(lineNum) * spacing;
-        lines[idx + 15] = -tickPt;
+
+    out = lines;
+    for (auto level = 0, step = 1; level < grid.levelCount; ++level, step *= 5) {
+        auto isTop = level == grid.levelCount - 1;
+        out = writeGridLevel(out, spacing * step, grid.levelMaxLine[level], isTop, -tickPt, tickPt);
     }
 
     glBindVertexArray(grid.vao[1]);
@@ -138,8 +215,8 @@ makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor)
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
 
-    grid.indexCount[0] = GLsizei(lineCnt * axisCnt * 2);
-    grid.indexCount[1] = GLsizei(lineCnt * axisCnt * 2);
+    grid.indexCount[0] = GLsizei(totalLines * axisCnt * 2);
+    grid.indexCount[1] = GLsizei(totalLines * axisCnt * 2);
     grid.indexCount[2] = GLsizei(4);
 
     grid.lineColors[0] = gridColor;
@@ -149,23 +226,133 @@ makeLineGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor)
     return grid;
 }
 
-GRID_DEF void renderLineGrid(LineGrid* grid, LineGridShader* program, Mat4* mvp)
+/*
+ * Number of lines in a run of a level that are closer to the axis than
+ * lineNum (in spacings of the level).
+ */
+static GLint linesBefore(i32 lineNum, bool isTop)
+{
+    auto before = lineNum - 1;
+    return isTop ? before : before - before / 5;
+}
+
+GRID_DEF void renderLineGrid(LineGrid* grid, LineGridShader* program, RenderState* state, Mat4* mvp, Vec2 viewport)
 {
     auto& linePrgm = program->lineProgramId;
     auto& mvpU     = program->lineMVP_uniform;
     auto& lineCol  = program->lineColor_uniform;
 
-    glUseProgram(linePrgm);
+    // Visible part of the world and how many pixels one unit covers.
+    auto inv     = inverseScaleTranslate(*mvp);
+    auto cornerA = inv * vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+    auto cornerB = inv * vec4( 1.0f,  1.0f, 0.0f, 1.0f);
+    auto minPt   = min_of(cornerA.xy, cornerB.xy);
+    auto maxPt   = max_of(cornerA.xy, cornerB.xy);
+    auto ppu     = fabsf(mvp->at(0, 0)) * viewport.x * 0.5f;
+
+    // Finest level that keeps lines GRID_MIN_PIXELS apart, faded in as it
+    // approaches twice that.
+    auto base    = 0;
+    auto spacing = grid->spacing;
+
+    while (base < grid->levelCount - 1 && spacing * ppu < GRID_MIN_PIXELS) {
+        spacing *= 5.0f;
+        ++base;
+    }
+
+    auto fade = clamp((spacing * ppu - GRID_MIN_PIXELS) / GRID_MIN_PIXELS, 0.0f, 1.0f);
+    if (base == grid->levelCount - 1)
+        fade = 1.0f;
+
+    setCapability(state, GL_LINE_SMOOTH, false);
+    setLineWidth(state, 1.0f);
+    setProgram(state, linePrgm);
     glUniformMatrix4fv(mvpU, 1, GL_FALSE, mvp->data);
 
-    for (auto idx = 0; idx < ARRAY_COUNT(grid->vao); ++idx) {
-        auto& color = grid->lineColors[idx];
+    for (auto idx = 0; idx < 2; ++idx) { // grid lines then ticks
+        auto& color    = grid->lineColors[idx];
+        auto  lvlSpace = spacing;
+
+        setVertexArray(state, grid->vao[idx]);
 
-        glUniform4f(lineCol, color.r, color.g, color.b, color.a);
-        glBindVertexArray(grid->vao[idx]);
-        glDrawArrays(GL_LINES, 0, grid->indexCount[idx]);
+        for (auto level = base; level < grid->levelCount; ++level, lvlSpace *= 5.0f) {
+            auto  isTop  = level == grid->levelCount - 1;
+            auto  maxLn  = grid->levelMaxLine[level];
+            auto  alpha  = level == base ? color.a * fade : color.a;
+            f32   lo[4]  = {  minPt.y, -maxPt.y,  minPt.x, -maxPt.x };
+            f32   hi[4]  = {  maxPt.y, -minPt.y,  maxPt.x, -minPt.x };
+            GLint   first[4];
+            GLsizei count[4];
+
+            for (auto run = 0; run < 4; ++run) {
+                auto firstLn = max_of(1.0f,       ceilf(lo[run] / lvlSpace));
+                auto lastLn  = min_of(f32(maxLn), floorf(hi[run] / lvlSpace));
+                auto runBase = grid->levelFirst[level] + run * grid->levelLines[level] * 2;
+
+                first[run] = runBase;
+                count[run] = 0;
+                if (firstLn <= lastLn) {
+                    auto startLn = linesBefore(i32(firstLn), isTop);
+                    auto endLn   = linesBefore(i32(lastLn) + 1, isTop);
+
+                    first[run] = runBase + startLn * 2;
+                    count[run] = (endLn - startLn) * 2;
+                }
+            }
+
+            glUniform4f(lineCol, color.r, color.g, color.b, alpha);
+            glMultiDrawArrays(GL_LINES, first, count, 4);
+        }
     }
-    glBindVertexArray(0);
+
+    auto& axisColor = grid->lineColors[2];
+
+    glUniform4f(lineCol, axisColor.r, axisColor.g, axisColor.b, axisColor.a);
+    setVertexArray(state, grid->vao[2]);
+    glDrawArrays(GL_LINES, 0, grid->indexCount[2]);
+    setVertexArray(state, 0);
+}
+
+GRID_DEF ProceduralGrid
+makeProceduralGrid(f32 spacing, Vec4 gridColor, Vec4 tickColor, Vec4 axisColor)
+{
+    auto grid = ProceduralGrid{};
+
+    // Core profile needs a vertex array bound to draw even without attributes.
+    glGenVertexArrays(1, &grid.vao);
+
+    grid.spacing       = spacing;
+    grid.tickLength    = 5.0f;
+    grid.lineColors[0] = gridColor;
+    grid.lineColors[1] = tickColor;
+    grid.lineColors[2] = axisColor;
+
+    return grid;
+}
+
+GRID_DEF void
+renderProceduralGrid(ProceduralGrid*       grid,
+                     ProceduralGridShader* program,
+                     RenderState*          state,
+                     Mat4*                 mvp,
+                     Vec2                  viewport)
+{
+    auto  inv  = inverseScaleTranslate(*mvp);
+    auto& grdC = grid->lineColors[0];
+    auto& tckC = grid->lineColors[1];
+    auto& axsC = grid->lineColors[2];
+
+    setProgram(state, program->programId);
+    glUniformMatrix4fv(program->inverseMVP_uniform, 1, GL_FALSE, inv.data);
+    glUniform2f(program->viewport_uniform, viewport.x, viewport.y);
+    glUniform1f(program->spacing_uniform, grid->spacing);
+    glUniform1f(program->tickLength_uniform, grid->tickLength);
+    glUniform4f(program->gridColor_uniform, grdC.r, grdC.g, grdC.b, grdC.a);
+    glUniform4f(program->tickColor_uniform, tckC.r, tckC.g, tckC.b, tckC.a);
+    glUniform4f(program->axisColor_uniform, axsC.r, axsC.g, axsC.b, axsC.a);
+    setVertexArray(state, grid->vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    setVertexArray(state, 0);
 }
 
 #endif // GRID_IMPLEMENTATION
@@ -8,8 +8,16 @@
 
 #include "m3d.h"
 #include "gl_util.h"
+#include "render_state.h"
+#include "stream_buffer.h"
 #include "grid.h"
 #include "bezier.h"
+#include "bezier_instanced.h"
+#include "bench.h"
+#include "point_grid.h"
+#include "bezier_query.h"
+#include "bezier_fill.h"
+#include "bezier_path.h"
 #include "font.h"
 #include "common.h"
 
@@ -21,6 +29,42 @@ char const *FRAG2D_SHADER =
 #include "shaders/frag2d.glsl"
 "";
 
+char const *VTX_BEZIER_SHADER =
+#include "shaders/vtxBezier.glsl"
+"";
+
+char const *VTX_STROKE_SHADER =
+#include "shaders/vtxStroke.glsl"
+"";
+
+char const *FRAG_STROKE_SHADER =
+#include "shaders/fragStroke.glsl"
+"";
+
+char const *VTX_FILL_SHADER =
+#include "shaders/vtxFill.glsl"
+"";
+
+char const *FRAG_FILL_SHADER =
+#include "shaders/fragFill.glsl"
+"";
+
+char const *VTX_BEZIER_INSTANCED_SHADER =
+#include "shaders/vtxBezierInstanced.glsl"
+"";
+
+char const *FRAG_INSTANCED_SHADER =
+#include "shaders/fragInstanced.glsl"
+"";
+
+char const *VTX_GRID_SHADER =
+#include "shaders/vtxGrid.glsl"
+"";
+
+char const *FRAG_GRID_SHADER =
+#include "shaders/fragGrid.glsl"
+"";
+
 char const *VTX_TEXT_SHADER =
 #include "shaders/vtxText.glsl"
 "";
@@ -35,25 +79,99 @@ struct Input {
     bool isPanMode   = false;
     bool action_1    = false;
     bool cursorMoved = false;
+    bool nextBench   = false;
+    bool toggleGrid  = false;
+    bool pickBench   = false;
+    bool crossBench  = false;
+    bool strokeBench = false;
+    bool lengthBench = false;
+    bool pathBench   = false;
+    bool conicBench  = false;
+    bool nextJoin    = false;
+    bool nextCap     = false;
+    bool nextStroke  = false;
+    bool toggleFill  = false;
+    bool togglePath  = false;
+    bool toggleConic = false;
     Vec2 cursorRel   = vec2(0, 0);
     Vec2 cursor      = vec2(0, 0);
 };
 
-bool isNearPoint(Vec2 src, Vec2 pt, f32 radius)
+Vec4 mapToWorldCoord(Mat4 const &view, f32 x, f32 y)
+{
+    auto eye = inverse(view);
+    return eye * vec4(x, y, 0.0f, 1.0f);
+}
+
+/*
+ * A circle, a wave drawn on from where the circle closed and a triangle,
+ * left of the curve.
+ */
+void fillDemoPath(BezierPath *path)
 {
-    auto minCorner = vec2(pt.x - radius, pt.y - radius);
-    auto maxCorner = vec2(pt.x + radius, pt.y + radius);
+    constexpr f32 KAPPA  = 0.5522848f;  // handle length of a quarter circle
+    constexpr f32 RADIUS = 80.0f;
 
-    return src.x <= maxCorner.x
-        && src.x >= minCorner.x
-        && src.y <= maxCorner.y
-        && src.y >= minCorner.y;
+    Vec2 const dirs[] = { vec2(1.0f, 0.0f), vec2(0.0f, 1.0f), vec2(-1.0f, 0.0f), vec2(0.0f, -1.0f), vec2(1.0f, 0.0f) };
+
+    auto center = vec2(-250.0f, 150.0f);
+
+    clearBezierPath(path);
+
+    bezierPathMoveTo(path, center + RADIUS * dirs[0]);
+    for (auto quarter = 0; quarter < 4; ++quarter) {
+        auto from = center + RADIUS * dirs[quarter];
+        auto to   = center + RADIUS * dirs[quarter + 1];
+
+        bezierPathCubicTo(path, from + KAPPA * RADIUS * dirs[quarter + 1], to + KAPPA * RADIUS * dirs[quarter], to);
+    }
+    bezierPathClose(path);
+
+    // No moveTo, the wave starts where the circle did.
+    for (auto wave = 0; wave < 3; ++wave) {
+        auto from = center + vec2(RADIUS + 60.0f * f32(wave), 0.0f);
+
+        bezierPathCubicTo(path, from + vec2(20.0f, 50.0f), from + vec2(40.0f, -50.0f), from + vec2(60.0f, 0.0f));
+        setBezierPathContinuity(path, path->segmentCount - 1, BEZIER_SEGMENT_SMOOTH);
+    }
+
+    bezierPathMoveTo(path, vec2(-330.0f, -60.0f));
+    bezierPathLineTo(path, vec2(-170.0f, -60.0f));
+    bezierPathLineTo(path, vec2(-250.0f, 60.0f));
+    bezierPathClose(path);
 }
 
-Vec4 mapToWorldCoord(Mat4 const &view, f32 x, f32 y)
+/*
+ * A circle, a turned ellipse and three quarters of a flat ellipse right
+ * of the curve, each exact as rational cubics.
+ */
+void fillDemoConics(BezierInstances *conics)
 {
-    auto eye = inverse(view);
-    return eye * vec4(x, y, 0.0f, 1.0f);
+    struct DemoArc {
+        Vec2 center;
+        Vec2 radii;
+        f32  rotation;
+        f32  start;
+        f32  sweep;
+    };
+
+    DemoArc const arcs[] = {
+        { vec2(400.0f, 180.0f), vec2(80.0f, 80.0f),  0.0f,       0.0f,       2.0f * PI  },
+        { vec2(400.0f, 180.0f), vec2(150.0f, 50.0f), PI / 6.0f,  0.0f,       2.0f * PI  },
+        { vec2(400.0f, -60.0f), vec2(120.0f, 40.0f), 0.0f,       0.25f * PI, 1.5f * PI  },
+    };
+
+    auto color = vec4(0.85f, 0.35f, 0.1f, 1.0f);
+
+    clearBezierInstances(conics);
+    for (auto& arc : arcs) {
+        RationalQuadratic pieces[BEZIER_CONIC_MAX_SEGMENTS];
+
+        auto count = conicArc(arc.center, arc.radii, arc.rotation, arc.start, arc.sweep, pieces);
+
+        for (u32 idx = 0; idx < count; ++idx)
+            addBezierInstance(conics, rationalBezierInstance(elevateBezier(pieces[idx]), color, 2.0f));
+    }
 }
 
 int main(int argc, char *argv[])
@@ -69,6 +187,9 @@ int main(int argc, char *argv[])
     int screen_w = 1024;
     int screen_h = 768;
 
+    // The curve fill counts coverage in the stencil buffer.
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+
     auto window = SDL_CreateWindow("Bezier",
                                    SDL_WINDOWPOS_UNDEFINED,
                                    SDL_WINDOWPOS_UNDEFINED,
@@ -99,34 +220,88 @@ int main(int argc, char *argv[])
     if (SDL_GL_SetSwapInterval(-1) == -1)
         SDL_GL_SetSwapInterval(1);
 
-    glEnable(GL_CULL_FACE);
+    auto renderState = makeRenderState();
+
+    setCapability(&renderState, GL_CULL_FACE, true);
     glCullFace(GL_BACK);
     glFrontFace(GL_CW);
-    glEnable(GL_BLEND);
+    setCapability(&renderState, GL_BLEND, true);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    auto vtx2d    = glCreateShader(GL_VERTEX_SHADER);
-    auto frag2d   = glCreateShader(GL_FRAGMENT_SHADER);
-    auto vtxTxt   = glCreateShader(GL_VERTEX_SHADER);
-    auto fragTxt  = glCreateShader(GL_FRAGMENT_SHADER);
-    auto linePrgm = glCreateProgram();
-    auto textPrgm = glCreateProgram();
-
-    if (!util::buildShader(vtx2d,   VTX2D_SHADER))     return EXIT_FAILURE;
-    if (!util::buildShader(frag2d,  FRAG2D_SHADER))    return EXIT_FAILURE;
-    if (!util::buildShader(vtxTxt,  VTX_TEXT_SHADER))  return EXIT_FAILURE;
-    if (!util::buildShader(fragTxt, FRAG_TEXT_SHADER)) return EXIT_FAILURE;
+    auto vtx2d     = glCreateShader(GL_VERTEX_SHADER);
+    auto frag2d    = glCreateShader(GL_FRAGMENT_SHADER);
+    auto vtxBez    = glCreateShader(GL_VERTEX_SHADER);
+    auto vtxStrk   = glCreateShader(GL_VERTEX_SHADER);
+    auto fragStrk  = glCreateShader(GL_FRAGMENT_SHADER);
+    auto vtxFill   = glCreateShader(GL_VERTEX_SHADER);
+    auto fragFill  = glCreateShader(GL_FRAGMENT_SHADER);
+    auto vtxInst   = glCreateShader(GL_VERTEX_SHADER);
+    auto fragInst  = glCreateShader(GL_FRAGMENT_SHADER);
+    auto vtxGrid   = glCreateShader(GL_VERTEX_SHADER);
+    auto fragGrid  = glCreateShader(GL_FRAGMENT_SHADER);
+    auto vtxTxt    = glCreateShader(GL_VERTEX_SHADER);
+    auto fragTxt   = glCreateShader(GL_FRAGMENT_SHADER);
+    auto linePrgm  = glCreateProgram();
+    auto curvePrgm = glCreateProgram();
+    auto strkPrgm  = glCreateProgram();
+    auto fillPrgm  = glCreateProgram();
+    auto instPrgm  = glCreateProgram();
+    auto gridPrgm  = glCreateProgram();
+    auto textPrgm  = glCreateProgram();
+
+    if (!util::buildShader(vtx2d,    VTX2D_SHADER))                return EXIT_FAILURE;
+    if (!util::buildShader(frag2d,   FRAG2D_SHADER))               return EXIT_FAILURE;
+    if (!util::buildShader(vtxBez,   VTX_BEZIER_SHADER))           return EXIT_FAILURE;
+    if (!util::buildShader(vtxStrk,  VTX_STROKE_SHADER))           return EXIT_FAILURE;
+    if (!util::buildShader(fragStrk, FRAG_STROKE_SHADER))          return EXIT_FAILURE;
+    if (!util::buildShader(vtxFill,  VTX_FILL_SHADER))             return EXIT_FAILURE;
+    if (!util::buildShader(fragFill, FRAG_FILL_SHADER))            return EXIT_FAILURE;
+    if (!util::buildShader(vtxInst,  VTX_BEZIER_INSTANCED_SHADER)) return EXIT_FAILURE;
+    if (!util::buildShader(fragInst, FRAG_INSTANCED_SHADER))       return EXIT_FAILURE;
+    if (!util::buildShader(vtxGrid,  VTX_GRID_SHADER))             return EXIT_FAILURE;
+    if (!util::buildShader(fragGrid, FRAG_GRID_SHADER))            return EXIT_FAILURE;
+    if (!util::buildShader(vtxTxt,   VTX_TEXT_SHADER))             return EXIT_FAILURE;
+    if (!util::buildShader(fragTxt,  FRAG_TEXT_SHADER))            return EXIT_FAILURE;
     glAttachShader(linePrgm, vtx2d);
     glAttachShader(linePrgm, frag2d);
+    glAttachShader(curvePrgm, vtxBez);
+    glAttachShader(curvePrgm, frag2d);
+    glAttachShader(strkPrgm, vtxStrk);
+    glAttachShader(strkPrgm, fragStrk);
+    glAttachShader(fillPrgm, vtxFill);
+    glAttachShader(fillPrgm, fragFill);
+    glAttachShader(instPrgm, vtxInst);
+    glAttachShader(instPrgm, fragInst);
+    glAttachShader(gridPrgm, vtxGrid);
+    glAttachShader(gridPrgm, fragGrid);
     glAttachShader(textPrgm, vtxTxt);
     glAttachShader(textPrgm, fragTxt);
-    if (!util::linkProgram(linePrgm)) return EXIT_FAILURE;
-    if (!util::linkProgram(textPrgm)) return EXIT_FAILURE;
+    if (!util::linkProgram(linePrgm))  return EXIT_FAILURE;
+    if (!util::linkProgram(curvePrgm)) return EXIT_FAILURE;
+    if (!util::linkProgram(strkPrgm))  return EXIT_FAILURE;
+    if (!util::linkProgram(fillPrgm))  return EXIT_FAILURE;
+    if (!util::linkProgram(instPrgm))  return EXIT_FAILURE;
+    if (!util::linkProgram(gridPrgm))  return EXIT_FAILURE;
+    if (!util::linkProgram(textPrgm))  return EXIT_FAILURE;
     glDeleteShader(vtx2d);
     glDeleteShader(frag2d);
+    glDeleteShader(vtxBez);
+    glDeleteShader(vtxStrk);
+    glDeleteShader(fragStrk);
+    glDeleteShader(vtxFill);
+    glDeleteShader(fragFill);
+    glDeleteShader(vtxInst);
+    glDeleteShader(fragInst);
+    glDeleteShader(vtxGrid);
+    glDeleteShader(fragGrid);
     glDeleteShader(vtxTxt);
     glDeleteShader(fragTxt);
     defer(glDeleteProgram(linePrgm));
+    defer(glDeleteProgram(curvePrgm));
+    defer(glDeleteProgram(strkPrgm));
+    defer(glDeleteProgram(fillPrgm));
+    defer(glDeleteProgram(instPrgm));
+    defer(glDeleteProgram(gridPrgm));
     defer(glDeleteProgram(textPrgm));
 
     auto findOrtho = [&]{
@@ -140,49 +315,170 @@ int main(int argc, char *argv[])
     auto screenMove   = identity();
     auto mvp          = ortho * screenCenter * screenZoom * flipY;
     auto gridShader   = LineGridShader{};
+    auto procShader   = ProceduralGridShader{};
     auto bezierShader = BezierShader{};
+    auto instShader   = BezierInstanceShader{};
+    auto fillShader   = BezierFillShader{};
+    auto pathShader   = BezierPathShader{};
 
     gridShader.lineProgramId     = linePrgm;
     gridShader.lineMVP_uniform   = glGetUniformLocation(linePrgm, "MVP");
     gridShader.lineColor_uniform = glGetUniformLocation(linePrgm, "LineColor");
 
+    procShader.programId          = gridPrgm;
+    procShader.inverseMVP_uniform = glGetUniformLocation(gridPrgm, "InverseMVP");
+    procShader.viewport_uniform   = glGetUniformLocation(gridPrgm, "Viewport");
+    procShader.spacing_uniform    = glGetUniformLocation(gridPrgm, "Spacing");
+    procShader.tickLength_uniform = glGetUniformLocation(gridPrgm, "TickLength");
+    procShader.gridColor_uniform  = glGetUniformLocation(gridPrgm, "GridColor");
+    procShader.tickColor_uniform  = glGetUniformLocation(gridPrgm, "TickColor");
+    procShader.axisColor_uniform  = glGetUniformLocation(gridPrgm, "AxisColor");
+
     bezierShader.lineProgramId     = gridShader.lineProgramId;
     bezierShader.lineColor_uniform = gridShader.lineColor_uniform;
     bezierShader.lineMVP_uniform   = gridShader.lineMVP_uniform;
 
+    bezierShader.curveProgramId             = curvePrgm;
+    bezierShader.curveMVP_uniform           = glGetUniformLocation(curvePrgm, "MVP");
+    bezierShader.curveColor_uniform         = glGetUniformLocation(curvePrgm, "LineColor");
+    bezierShader.curveControlPoints_uniform = glGetUniformLocation(curvePrgm, "ControlPoints");
+    bezierShader.curveSegments_uniform      = glGetUniformLocation(curvePrgm, "Segments");
+
+    bezierShader.strokeProgramId        = strkPrgm;
+    bezierShader.strokeMVP_uniform      = glGetUniformLocation(strkPrgm, "MVP");
+    bezierShader.strokeViewport_uniform = glGetUniformLocation(strkPrgm, "Viewport");
+    bezierShader.strokeWidth_uniform    = glGetUniformLocation(strkPrgm, "Width");
+    bezierShader.strokeCap_uniform      = glGetUniformLocation(strkPrgm, "Cap");
+    bezierShader.strokeColor_uniform    = glGetUniformLocation(strkPrgm, "LineColor");
+
+    pathShader.programId     = linePrgm;
+    pathShader.MVP_uniform   = gridShader.lineMVP_uniform;
+    pathShader.color_uniform = gridShader.lineColor_uniform;
+
+    fillShader.programId     = fillPrgm;
+    fillShader.MVP_uniform   = glGetUniformLocation(fillPrgm, "MVP");
+    fillShader.color_uniform = glGetUniformLocation(fillPrgm, "FillColor");
+
+    instShader.programId        = instPrgm;
+    instShader.MVP_uniform      = glGetUniformLocation(instPrgm, "MVP");
+    instShader.viewport_uniform = glGetUniformLocation(instPrgm, "Viewport");
+    instShader.segments_uniform = glGetUniformLocation(instPrgm, "Segments");
+
     bezierShader.textProgramId       = textPrgm;
     bezierShader.textMVP_uniform     = glGetUniformLocation(textPrgm, "MVP");
-    bezierShader.textOffset_uniform  = glGetUniformLocation(textPrgm, "TextOffset");
+    bezierShader.textLineMVP_uniform = glGetUniformLocation(textPrgm, "LineMVP");
     bezierShader.textColor_uniform   = glGetUniformLocation(textPrgm, "TextColor");
     bezierShader.textTexture_uniform = glGetUniformLocation(textPrgm, "TextTexture");
 
+    constexpr size_t STARTUP_ARENA_SIZE = 4 * 1024 * 1024;
+    constexpr size_t FRAME_ARENA_SIZE   = 1024 * 1024;
+
+    // Scratch for loading and scratch that only lives for one frame.
+    auto startupArena = makeArena(STARTUP_ARENA_SIZE);
+    auto frameArena   = makeArena(FRAME_ARENA_SIZE);
+    defer(freeArena(&startupArena));
+    defer(freeArena(&frameArena));
+
+    if (startupArena.base == nullptr || frameArena.base == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for the scratch arenas.\n");
+        return EXIT_FAILURE;
+    }
+    defer(SDL_Log("Arena high water: startup %zu of %zu bytes, frame %zu of %zu bytes.",
+                  startupArena.highWater, startupArena.size,
+                  frameArena.highWater,   frameArena.size));
+
     constexpr char const *FONT_FILE = "assets/Roboto-Regular.ttf";
 
     auto font = Font{};
     glGenTextures(1, &font.texId);
-    fillFontData(FONT_FILE, &font);
+    fillFontData(FONT_FILE, &font, &startupArena);
+
+    constexpr u32 STREAM_SIZE = 4 * 1024 * 1024;
+
+    auto stream = makeStreamBuffer(STREAM_SIZE);
+    defer(freeStreamBuffer(&stream));
 
     auto black  = vec4(0.0f, 0.0f, 0.0f, 1.0f);
-    auto grid   = makeLineGrid(25.0f, vec4(0.1f, 0.35f, 0.8f, 0.4f), black, black);
+    auto blue   = vec4(0.1f, 0.35f, 0.8f, 0.4f);
+    auto grid   = makeLineGrid(25.0f, blue, black, black, &startupArena);
+    auto pgrid  = makeProceduralGrid(25.0f, blue, black, black);
     auto bezier = makeBezier(64);
 
-    loadBezierVertices(&bezier, &font);
+    // Wide strokes are drawn from the tessellated polyline, not with glLineWidth.
+    bezier.setTessellation(BezierTessellation::Adaptive);
+    loadBezierVertices(&bezier, &font, &stream, &frameArena, &renderState);
     bezier.setLineSize(1.0f).setLineColor(0.7f, 0.3f, 0.05f, 1.0f);
-    bezier.setCurveSize(3.0f).setCurveColor(0.1f, 0.9f, 0.25f, 1.0f);
+    auto curveColor = vec4(0.1f, 0.9f, 0.25f, 1.0f);
+    auto hoverColor = vec4(0.95f, 0.55f, 0.1f, 1.0f);
+
+    bezier.setCurveSize(3.0f).setCurveColor(curveColor.r, curveColor.g, curveColor.b, curveColor.a);
     bezier.setPointSize(6.0f).setPointColor(0.1f, 0.3f, 0.85f, 1.0f);
     bezier.setTextColor(0.05f, 0.05f, 0.05f, 1.0f);
 
+    // The curve closed by its chord.
+    auto fill      = makeBezierFill(1);
+    auto fillColor = vec4(0.1f, 0.9f, 0.25f, 0.25f);
+    auto isFilled  = false;
+    defer(freeBezierFill(&fill));
+
+    // Three subpaths out of one vertex buffer, drawn with one call.
+    auto path        = makeBezierPath(16);
+    auto pathColor   = vec4(0.55f, 0.2f, 0.7f, 1.0f);
+    auto isPathShown = false;
+    defer(freeBezierPath(&path));
+
+    fillDemoPath(&path);
+
+    auto pathMesh = makeBezierPathMesh(bezierPathVertexBound(&path, bezier.segments));
+    defer(freeBezierPathMesh(&pathMesh));
+
+    loadBezierPath(&pathMesh, &path, bezier.segments, &stream, &frameArena, &renderState);
+
+    // Conic arcs drawn by the instanced renderer with their weights.
+    auto conics        = makeBezierInstances(3 * BEZIER_CONIC_MAX_SEGMENTS, bezier.segments);
+    auto isConicsShown = false;
+    defer(freeBezierInstances(&conics));
+
+    fillDemoConics(&conics);
+
     constexpr i32 CONTROL_PT_NOT_MOVING = -1;
+    constexpr u32 BENCH_CURVES          = 2000;
+    constexpr u32 BENCH_PICK_POINTS     = 1000000;
+    constexpr u32 BENCH_HOVER_CURVES    = 50000;
+    constexpr u32 BENCH_CROSS_CURVES    = 50000;
+    constexpr u32 BENCH_STROKE_CURVES   = 10000;
+    constexpr u32 BENCH_LENGTH_CURVES   = 10000;
+    constexpr u32 BENCH_PATH_SUBPATHS   = 10000;
+    constexpr u32 BENCH_CONIC_ELLIPSES  = 10000;
+    constexpr f32 PICK_PIXELS           = 8.0f;
+
+    // Picking radius is in pixels, the cells match it at 1x zoom.
+    auto cpGrid = makePointGrid(PICK_PIXELS, ARRAY_COUNT(bezier.cp));
+    defer(freePointGrid(&cpGrid));
+
+    for (auto idx = 0; idx < ARRAY_COUNT(bezier.cp); ++idx)
+        addGridPoint(&cpGrid, bezier.cp[idx]);
+
+    auto isProcGrid = false;
+    auto benchMode  = BenchMode::Off;
+    auto benchScene = BenchScene{};
+    auto benchStats = FrameStats{};
 
     auto running    = true;
     auto prevInput  = Input{};
     auto movedCntPt = CONTROL_PT_NOT_MOVING;
+    auto dragBytes  = u64(0);
+    auto dragWaits  = u32(0);
     auto cursor     = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_ARROW);
     defer(SDL_FreeCursor(cursor));
 
     SDL_SetCursor(cursor);
 
     while (running) {
+        resetRenderStateStats(&renderState);
+        resetArena(&frameArena);
+
         auto event   = SDL_Event{};
         auto input   = Input{};
         auto resized = false;
@@ -232,6 +528,24 @@ int main(int argc, char *argv[])
                 }
             } break;
 
+            case SDL_KEYDOWN: {
+                auto& key = event.key;
+                if (key.keysym.sym == SDLK_b && !key.repeat) input.nextBench  = true;
+                if (key.keysym.sym == SDLK_g && !key.repeat) input.toggleGrid = true;
+                if (key.keysym.sym == SDLK_p && !key.repeat) input.pickBench  = true;
+                if (key.keysym.sym == SDLK_i && !key.repeat) input.crossBench = true;
+                if (key.keysym.sym == SDLK_s && !key.repeat) input.strokeBench = true;
+                if (key.keysym.sym == SDLK_l && !key.repeat) input.lengthBench = true;
+                if (key.keysym.sym == SDLK_t && !key.repeat) input.pathBench  = true;
+                if (key.keysym.sym == SDLK_r && !key.repeat) input.conicBench = true;
+                if (key.keysym.sym == SDLK_j && !key.repeat) input.nextJoin   = true;
+                if (key.keysym.sym == SDLK_c && !key.repeat) input.nextCap    = true;
+                if (key.keysym.sym == SDLK_d && !key.repeat) input.nextStroke = true;
+                if (key.keysym.sym == SDLK_f && !key.repeat) input.toggleFill = true;
+                if (key.keysym.sym == SDLK_o && !key.repeat) input.togglePath = true;
+                if (key.keysym.sym == SDLK_e && !key.repeat) input.toggleConic = true;
+            } break;
+
             case SDL_MOUSEWHEEL: {
                 auto& wheel = event.wheel;
                 if (wheel.y > 0) input.zoomingIn  = true;
@@ -290,31 +604,97 @@ int main(int argc, char *argv[])
         if (input.zoomingOut && screenZoom.data[0] > 0.25f) {
             zoom(0.5f);
         }
+        // Adaptive tessellation depends on how large the curve is on screen.
+        bezier.setScreenScale(screenZoom.data[0]);
 
         if (input.action_1 && !prevInput.action_1) {
             auto pos = mapToWorldCoord(view, input.cursor.x, input.cursor.y);
+            auto hit = findNearestPoint(&cpGrid, vec2(pos.x, pos.y), PICK_PIXELS / screenZoom.data[0]);
 
-            for (auto idx = 0; idx < ARRAY_COUNT(bezier.cp); ++idx) {
-                auto& cp = bezier.cp[idx];
-
-                if (isNearPoint(vec2(pos.x, pos.y), cp, 8.0f)) {
-                    movedCntPt = idx;
-                    break;
-                }
-            }
+            if (hit != POINT_GRID_NONE)
+                movedCntPt = i32(hit);
         }
 
         if (!input.action_1 && prevInput.action_1) {
+            if (movedCntPt > CONTROL_PT_NOT_MOVING)
+                SDL_Log("Control point drag uploaded %llu bytes, the staging ring waited %u times.",
+                        (unsigned long long) dragBytes, dragWaits);
             movedCntPt = CONTROL_PT_NOT_MOVING;
+            dragBytes  = 0;
+            dragWaits  = 0;
         }
 
         if (movedCntPt > CONTROL_PT_NOT_MOVING && input.cursorMoved) {
             auto pos = mapToWorldCoord(view, input.cursor.x, input.cursor.y);
 
-            bezier.cp[movedCntPt].x = pos.x;
-            bezier.cp[movedCntPt].y = pos.y;
+            bezier.setControlPoint(movedCntPt, vec2(pos.x, pos.y));
+            moveGridPoint(&cpGrid, u32(movedCntPt), vec2(pos.x, pos.y));
+        }
+
+        if (input.cursorMoved) {
+            auto pos   = mapToWorldCoord(view, input.cursor.x, input.cursor.y);
+            auto hit   = nearestPointOnBezier(bezier, vec2(pos.x, pos.y));
+            auto color = hit.distance <= PICK_PIXELS / screenZoom.data[0] ? hoverColor : curveColor;
+
+            bezier.setCurveColor(color.r, color.g, color.b, color.a);
+        }
+
+        if (input.toggleFill)
+            isFilled = !isFilled;
+
+        if (input.togglePath)
+            isPathShown = !isPathShown;
+
+        if (input.toggleConic)
+            isConicsShown = !isConicsShown;
+
+        // Zooming never touches the fill, only moving control points does.
+        if (isFilled && (bezier.dirtyPoints || input.toggleFill))
+            loadBezierFill(&fill, bezier.cp, 1, &stream, &renderState);
+
+        updateBezierVertices(&bezier, &font, &stream, &frameArena, &renderState);
+        if (movedCntPt > CONTROL_PT_NOT_MOVING) {
+            dragBytes += renderState.uploadedBytes;
+            dragWaits += stream.waits;
+        }
+
+        if (input.toggleGrid)
+            isProcGrid = !isProcGrid;
+
+        if (input.pickBench)
+            runPickBench(BENCH_PICK_POINTS, BENCH_HOVER_CURVES, PICK_PIXELS);
+
+        if (input.crossBench)
+            runIntersectBench(BENCH_CROSS_CURVES, SDL_GetCPUCount());
+
+        if (input.strokeBench)
+            runStrokeBench(BENCH_STROKE_CURVES, bezier.segments, 24.0f);
+
+        if (input.lengthBench)
+            runLengthBench(BENCH_LENGTH_CURVES, 64, 1024);
+
+        if (input.pathBench)
+            runPathBench(BENCH_PATH_SUBPATHS, bezier.segments);
 
-            loadBezierVertices(&bezier, &font);
+        if (input.conicBench)
+            runConicBench(BENCH_CONIC_ELLIPSES, bezier.segments + 1);
+
+        if (input.nextJoin)
+            bezier.setCurveJoin(StrokeJoin((i32(bezier.curveJoin) + 1) % i32(StrokeJoin::Count)));
+        if (input.nextCap)
+            bezier.setCurveCap(StrokeCap((i32(bezier.curveCap) + 1) % i32(StrokeCap::Count)));
+        if (input.nextStroke) {
+            auto isDistance = bezier.curveStroke == BezierStroke::Distance;
+
+            bezier.setCurveStroke(isDistance ? BezierStroke::Triangles : BezierStroke::Distance);
+        }
+
+        if (input.nextBench) {
+            benchMode  = BenchMode((i32(benchMode) + 1) % i32(BenchMode::Count));
+            benchStats = FrameStats{};
+            if (benchMode != BenchMode::Off && benchScene.curveCount == 0)
+                benchScene = makeBenchScene(BENCH_CURVES, bezier.segments,
+                                            &font, &stream, &frameArena, &renderState);
         }
 
         prevInput = input;
@@ -323,11 +703,39 @@ int main(int argc, char *argv[])
         auto textMvp = ortho * screenCenter * screenMove * flipY;
 
         glClearColor(0.98f, 0.98f, 0.98f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        renderLineGrid(&grid, &gridShader, &mvp);
-        renderBezier(&bezier, &bezierShader, &font, &mvp, &textMvp);
+        glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+        auto viewport = vec2(f32(screen_w), f32(screen_h));
+
+        if (isProcGrid)
+            renderProceduralGrid(&pgrid, &procShader, &renderState, &mvp, viewport);
+        else
+            renderLineGrid(&grid, &gridShader, &renderState, &mvp, viewport);
+
+        if (benchMode == BenchMode::Off) {
+            if (isFilled)
+                renderBezierFill(&fill, &fillShader, &renderState, &mvp, fillColor);
+            if (isPathShown)
+                renderBezierPath(&pathMesh, &pathShader, &renderState, &mvp, pathColor);
+            if (isConicsShown)
+                renderBezierInstances(&conics, &instShader, &renderState, &mvp, viewport);
+            renderBezier(&bezier, &bezierShader, &renderState, &font, &mvp, &textMvp, viewport);
+        } else {
+
+            beginFrameStats(&benchStats);
+            auto drawCalls = renderBenchScene(&benchScene, benchMode,
+                                              &bezierShader, &instShader,
+                                              &renderState, &font,
+                                              &mvp, &textMvp, viewport);
+            glFinish();
+            endFrameStats(&benchStats,
+                          benchMode == BenchMode::Instanced ? "instanced" : "per bezier",
+                          drawCalls,
+                          &renderState,
+                          &stream);
+        }
 
+        fenceStreamBuffer(&stream);
         SDL_GL_SwapWindow(window);
     }
 
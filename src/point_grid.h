@@ -0,0 +1,234 @@
+#ifndef GUARD_INCLUDE_POINT_GRID_H
+#define GUARD_INCLUDE_POINT_GRID_H
+
+#ifdef POINT_GRID_STATIC
+    #define POINT_GRID_DEF static
+#else
+    #define POINT_GRID_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+
+/*
+ * Spatial hash of points on a uniform grid of cellSize world units.
+ * Every point is on an intrusive list of the bucket its cell hashes to,
+ * so moving a point is an unlink and a link.  Cells that collide share
+ * a bucket, queries check the distance anyway.
+ *
+ * Points are numbered in the order they were added.
+ */
+struct PointGrid {
+    f32  cellSize;
+    f32  invCellSize;
+    u32  bucketMask;
+    u32 *buckets;       // first point of each bucket
+
+    f32 *x;
+    f32 *y;
+    u32 *next;
+    u32 *prev;
+    u32 *bucketOf;
+    u32  count;
+    u32  capacity;
+};
+
+constexpr u32 POINT_GRID_NONE = 0xffffffff;
+
+POINT_GRID_DEF PointGrid makePointGrid(f32 cellSize, u32 capacity);
+POINT_GRID_DEF void      freePointGrid(PointGrid *grid);
+POINT_GRID_DEF void      clearPointGrid(PointGrid *grid);
+
+POINT_GRID_DEF u32  addGridPoint(PointGrid *grid, Vec2 pos);
+POINT_GRID_DEF void moveGridPoint(PointGrid *grid, u32 point, Vec2 pos);
+
+/*
+ * The point closest to pos that is at most radius away, or
+ * POINT_GRID_NONE.  Pass the pick radius in pixels divided by the pixels
+ * per world unit to pick in screen space.
+ */
+POINT_GRID_DEF u32 findNearestPoint(PointGrid const *grid, Vec2 pos, f32 radius);
+
+#endif // GUARD_INCLUDE_POINT_GRID_H
+
+
+#ifdef POINT_GRID_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <math.h>
+#include <SDL_log.h>
+
+static u32 hashCell(i32 cx, i32 cy)
+{
+    auto h = u32(cx) * 0x9E3779B1u ^ u32(cy) * 0x85EBCA77u;
+
+    return h ^ (h >> 15);
+}
+
+static u32 pointBucket(PointGrid const *grid, f32 x, f32 y)
+{
+    auto cx = i32(floorf(x * grid->invCellSize));
+    auto cy = i32(floorf(y * grid->invCellSize));
+
+    return hashCell(cx, cy) & grid->bucketMask;
+}
+
+static void linkPoint(PointGrid *grid, u32 point)
+{
+    auto bucket = pointBucket(grid, grid->x[point], grid->y[point]);
+    auto head   = grid->buckets[bucket];
+
+    grid->bucketOf[point] = bucket;
+    grid->prev[point]     = POINT_GRID_NONE;
+    grid->next[point]     = head;
+    if (head != POINT_GRID_NONE)
+        grid->prev[head] = point;
+    grid->buckets[bucket] = point;
+}
+
+static void unlinkPoint(PointGrid *grid, u32 point)
+{
+    auto prev = grid->prev[point];
+    auto next = grid->next[point];
+
+    if (prev != POINT_GRID_NONE) grid->next[prev] = next;
+    else                         grid->buckets[grid->bucketOf[point]] = next;
+    if (next != POINT_GRID_NONE) grid->prev[next] = prev;
+}
+
+static void *growPointArray(void *array, size_t size)
+{
+    auto grown = realloc(array, size);
+
+    if (grown == nullptr) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                        "Not enough memory for a point grid.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+/*
+ * Size the arrays for capacity points and twice as many buckets and put
+ * every point back in its bucket.
+ */
+static void resizePointGrid(PointGrid *grid, u32 capacity)
+{
+    auto bucketCnt = u32(1);
+
+    while (bucketCnt < 2 * capacity)
+        bucketCnt *= 2;
+
+    grid->x        = (f32*) growPointArray(grid->x,        capacity * sizeof(f32));
+    grid->y        = (f32*) growPointArray(grid->y,        capacity * sizeof(f32));
+    grid->next     = (u32*) growPointArray(grid->next,     capacity * sizeof(u32));
+    grid->prev     = (u32*) growPointArray(grid->prev,     capacity * sizeof(u32));
+    grid->bucketOf = (u32*) growPointArray(grid->bucketOf, capacity * sizeof(u32));
+    grid->buckets  = (u32*) growPointArray(grid->buckets,  bucketCnt * sizeof(u32));
+    grid->capacity   = capacity;
+    grid->bucketMask = bucketCnt - 1;
+
+    for (u32 bucket = 0; bucket < bucketCnt; ++bucket)
+        grid->buckets[bucket] = POINT_GRID_NONE;
+    for (u32 point = 0; point < grid->count; ++point)
+        linkPoint(grid, point);
+}
+
+POINT_GRID_DEF PointGrid makePointGrid(f32 cellSize, u32 capacity)
+{
+    auto grid = PointGrid{};
+
+    grid.cellSize    = cellSize;
+    grid.invCellSize = 1.0f / cellSize;
+    resizePointGrid(&grid, capacity > 0 ? capacity : 1);
+
+    return grid;
+}
+
+POINT_GRID_DEF void freePointGrid(PointGrid *grid)
+{
+    free(grid->x);
+    free(grid->y);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->bucketOf);
+    free(grid->buckets);
+    *grid = PointGrid{};
+}
+
+POINT_GRID_DEF void clearPointGrid(PointGrid *grid)
+{
+    for (u32 bucket = 0; bucket <= grid->bucketMask; ++bucket)
+        grid->buckets[bucket] = POINT_GRID_NONE;
+    grid->count = 0;
+}
+
+POINT_GRID_DEF u32 addGridPoint(PointGrid *grid, Vec2 pos)
+{
+    if (grid->count == grid->capacity)
+        resizePointGrid(grid, grid->capacity * 2);
+
+    auto point = grid->count++;
+
+    grid->x[point] = pos.x;
+    grid->y[point] = pos.y;
+    linkPoint(grid, point);
+
+    return point;
+}
+
+POINT_GRID_DEF void moveGridPoint(PointGrid *grid, u32 point, Vec2 pos)
+{
+    grid->x[point] = pos.x;
+    grid->y[point] = pos.y;
+
+    auto bucket = pointBucket(grid, pos.x, pos.y);
+
+    if (bucket != grid->bucketOf[point]) {
+        unlinkPoint(grid, point);
+        linkPoint(grid, point);
+    }
+}
+
+POINT_GRID_DEF u32 findNearestPoint(PointGrid const *grid, Vec2 pos, f32 radius)
+{
+    auto best   = POINT_GRID_NONE;
+    auto bestSq = radius * radius;
+
+    auto test = [&](u32 point) {
+        auto dx = grid->x[point] - pos.x;
+        auto dy = grid->y[point] - pos.y;
+        auto sq = dx * dx + dy * dy;
+
+        if (sq <= bestSq) {
+            best   = point;
+            bestSq = sq;
+        }
+    };
+
+    auto minX = i32(floorf((pos.x - radius) * grid->invCellSize));
+    auto maxX = i32(floorf((pos.x + radius) * grid->invCellSize));
+    auto minY = i32(floorf((pos.y - radius) * grid->invCellSize));
+    auto maxY = i32(floorf((pos.y + radius) * grid->invCellSize));
+    auto cells = u64(maxX - minX + 1) * u64(maxY - minY + 1);
+
+    // With a radius that large compared to the cells every bucket is visited anyway.
+    if (cells > grid->count) {
+        for (u32 point = 0; point < grid->count; ++point)
+            test(point);
+        return best;
+    }
+
+    for (auto cy = minY; cy <= maxY; ++cy) {
+        for (auto cx = minX; cx <= maxX; ++cx) {
+            auto bucket = hashCell(cx, cy) & grid->bucketMask;
+
+            for (auto point = grid->buckets[bucket]; point != POINT_GRID_NONE; point = grid->next[point])
+                test(point);
+        }
+    }
+
+    return best;
+}
+
+#endif // POINT_GRID_IMPLEMENTATION
@@ -0,0 +1,223 @@
+#ifndef GUARD_INCLUDE_RENDER_STATE_H
+#define GUARD_INCLUDE_RENDER_STATE_H
+
+#ifdef RENDER_STATE_STATIC
+    #define RENDER_STATE_DEF static
+#else
+    #define RENDER_STATE_DEF extern
+#endif
+
+#include <glad/glad.h>
+
+#include "common.h"
+
+/*
+ * Shadow copy of the OpenGL state the renderers touch.  Changes that
+ * match the shadow are skipped so there is never a need to query the
+ * driver (glGet* can force a pipeline sync on some drivers).
+ *
+ * Everything that goes through the set* functions below must keep doing
+ * so.  Code that changes the tracked state directly has to call
+ * invalidateRenderState afterwards.
+ */
+struct RenderState {
+    GLuint program;
+    GLuint vertexArray;
+    GLuint texture2D;
+    GLenum activeTexture;
+    f32    lineWidth;
+    f32    pointSize;
+    u32    enabled;         // bit per tracked capability
+    u32    known;           // bit per tracked value that matches the driver
+
+    u32    issuedCalls;     // GL calls made this frame
+    u32    elidedCalls;     // GL calls skipped this frame
+    u64    uploadedBytes;   // buffer bytes uploaded this frame
+};
+
+/*
+ * Start with every value unknown so the first change is always issued.
+ */
+RENDER_STATE_DEF RenderState makeRenderState();
+RENDER_STATE_DEF void        invalidateRenderState(RenderState *state);
+
+/*
+ * Reset the per frame call counters.
+ */
+RENDER_STATE_DEF void resetRenderStateStats(RenderState *state);
+
+RENDER_STATE_DEF void setProgram(RenderState *state, GLuint program);
+RENDER_STATE_DEF void setVertexArray(RenderState *state, GLuint vao);
+RENDER_STATE_DEF void setActiveTexture(RenderState *state, GLenum unit);
+RENDER_STATE_DEF void setTexture2D(RenderState *state, GLuint texture);
+RENDER_STATE_DEF void setLineWidth(RenderState *state, f32 width);
+RENDER_STATE_DEF void setPointSize(RenderState *state, f32 size);
+
+/*
+ * glBufferSubData on the buffer bound to target, counted in uploadedBytes.
+ */
+RENDER_STATE_DEF void bufferSubData(RenderState *state, GLenum target, GLintptr offset, GLsizeiptr size, void const *data);
+
+/*
+ * Enable or disable cap.  Capabilities that aren't tracked are always
+ * passed through to the driver.
+ */
+RENDER_STATE_DEF void setCapability(RenderState *state, GLenum cap, bool isEnabled);
+
+/*
+ * The shadowed value of cap.  False if cap isn't tracked or was never set.
+ */
+RENDER_STATE_DEF bool isCapabilityEnabled(RenderState const *state, GLenum cap);
+
+#endif // GUARD_INCLUDE_RENDER_STATE_H
+
+
+#ifdef RENDER_STATE_IMPLEMENTATION
+
+enum RenderStateKnown : u32 {
+    RS_KNOWN_PROGRAM        = 1 << 0,
+    RS_KNOWN_VERTEX_ARRAY   = 1 << 1,
+    RS_KNOWN_TEXTURE_2D     = 1 << 2,
+    RS_KNOWN_ACTIVE_TEXTURE = 1 << 3,
+    RS_KNOWN_LINE_WIDTH     = 1 << 4,
+    RS_KNOWN_POINT_SIZE     = 1 << 5,
+    RS_KNOWN_CAP_FIRST      = 1 << 8,   // one bit per tracked capability from here
+};
+
+static GLenum const RS_CAPABILITIES[] = {
+    GL_BLEND,
+    GL_CULL_FACE,
+    GL_DEPTH_TEST,
+    GL_SCISSOR_TEST,
+    GL_STENCIL_TEST,
+    GL_LINE_SMOOTH,
+    GL_MULTISAMPLE,
+};
+
+static i32 capabilityIndex(GLenum cap)
+{
+    for (auto idx = 0; idx < ARRAY_COUNT(RS_CAPABILITIES); ++idx) {
+        if (RS_CAPABILITIES[idx] == cap)
+            return idx;
+    }
+    return -1;
+}
+
+/*
+ * Returns true if the call has to be made, counting it either way.
+ */
+static bool needsCall(RenderState *state, u32 knownBit, bool isSame)
+{
+    if ((state->known & knownBit) && isSame) {
+        ++state->elidedCalls;
+        return false;
+    }
+
+    state->known |= knownBit;
+    ++state->issuedCalls;
+    return true;
+}
+
+RENDER_STATE_DEF RenderState makeRenderState()
+{
+    return RenderState{};
+}
+
+RENDER_STATE_DEF void invalidateRenderState(RenderState *state)
+{
+    state->known = 0;
+}
+
+RENDER_STATE_DEF void resetRenderStateStats(RenderState *state)
+{
+    state->issuedCalls   = 0;
+    state->elidedCalls   = 0;
+    state->uploadedBytes = 0;
+}
+
+RENDER_STATE_DEF void setProgram(RenderState *state, GLuint program)
+{
+    if (needsCall(state, RS_KNOWN_PROGRAM, state->program == program)) {
+        state->program = program;
+        glUseProgram(program);
+    }
+}
+
+RENDER_STATE_DEF void setVertexArray(RenderState *state, GLuint vao)
+{
+    if (needsCall(state, RS_KNOWN_VERTEX_ARRAY, state->vertexArray == vao)) {
+        state->vertexArray = vao;
+        glBindVertexArray(vao);
+    }
+}
+
+RENDER_STATE_DEF void setActiveTexture(RenderState *state, GLenum unit)
+{
+    if (needsCall(state, RS_KNOWN_ACTIVE_TEXTURE, state->activeTexture == unit)) {
+        state->activeTexture = unit;
+        // The texture binding is per unit.
+        state->known &= ~u32(RS_KNOWN_TEXTURE_2D);
+        glActiveTexture(unit);
+    }
+}
+
+RENDER_STATE_DEF void setTexture2D(RenderState *state, GLuint texture)
+{
+    if (needsCall(state, RS_KNOWN_TEXTURE_2D, state->texture2D == texture)) {
+        state->texture2D = texture;
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+RENDER_STATE_DEF void setLineWidth(RenderState *state, f32 width)
+{
+    if (needsCall(state, RS_KNOWN_LINE_WIDTH, state->lineWidth == width)) {
+        state->lineWidth = width;
+        glLineWidth(width);
+    }
+}
+
+RENDER_STATE_DEF void setPointSize(RenderState *state, f32 size)
+{
+    if (needsCall(state, RS_KNOWN_POINT_SIZE, state->pointSize == size)) {
+        state->pointSize = size;
+        glPointSize(size);
+    }
+}
+
+RENDER_STATE_DEF void bufferSubData(RenderState *state, GLenum target, GLintptr offset, GLsizeiptr size, void const *data)
+{
+    state->uploadedBytes += u64(size);
+    ++state->issuedCalls;
+    glBufferSubData(target, offset, size, data);
+}
+
+RENDER_STATE_DEF void setCapability(RenderState *state, GLenum cap, bool isEnabled)
+{
+    auto idx = capabilityIndex(cap);
+
+    if (idx >= 0) {
+        auto bit    = u32(1) << idx;
+        auto isSame = ((state->enabled & bit) != 0) == isEnabled;
+
+        if (!needsCall(state, u32(RS_KNOWN_CAP_FIRST) << idx, isSame))
+            return;
+
+        if (isEnabled) state->enabled |= bit;
+        else           state->enabled &= ~bit;
+    } else {
+        ++state->issuedCalls;
+    }
+
+    if (isEnabled) glEnable(cap);
+    else           glDisable(cap);
+}
+
+RENDER_STATE_DEF bool isCapabilityEnabled(RenderState const *state, GLenum cap)
+{
+    auto idx = capabilityIndex(cap);
+
+    return idx >= 0 && (state->enabled & (u32(1) << idx)) != 0;
+}
+
+#endif // RENDER_STATE_IMPLEMENTATION
@@ -0,0 +1,18 @@
+R"(
+#version 330 core
+
+in vec3 klm;
+
+out vec4 fragColor;
+
+uniform vec4 FillColor;
+
+void main()
+{
+    // Implicit form of the curve, negative on the filled side.
+    if (klm.x * klm.x * klm.x - klm.y * klm.z > 0.0f)
+        discard;
+
+    fragColor = FillColor;
+}
+)"
@@ -0,0 +1,50 @@
+R"(
+#version 330 core
+
+out vec4 fragColor;
+
+uniform mat4  InverseMVP;
+uniform vec2  Viewport;
+uniform float Spacing;
+uniform float TickLength;
+uniform vec4  GridColor;
+uniform vec4  TickColor;
+uniform vec4  AxisColor;
+
+// Coverage of a one pixel wide line through every multiple of period.
+float lineCoverage(float coord, float period, float pixel)
+{
+    float dist = abs(fract(coord / period + 0.5f) - 0.5f) * period;
+
+    return clamp(1.0f - dist / pixel, 0.0f, 1.0f);
+}
+
+vec4 over(vec4 dst, vec4 src)
+{
+    float alpha = src.a + dst.a * (1.0f - src.a);
+    vec3  color = src.rgb * src.a + dst.rgb * dst.a * (1.0f - src.a);
+
+    return vec4(color / max(alpha, 1e-6f), alpha);
+}
+
+void main()
+{
+    vec2 ndc   = gl_FragCoord.xy / Viewport * 2.0f - 1.0f;
+    vec2 world = (InverseMVP * vec4(ndc, 0.0f, 1.0f)).xy;
+    vec2 pixel = fwidth(world);
+
+    float gridX = lineCoverage(world.x, Spacing, pixel.x);
+    float gridY = lineCoverage(world.y, Spacing, pixel.y);
+    float axisX = clamp(1.0f - abs(world.x) / pixel.x, 0.0f, 1.0f);
+    float axisY = clamp(1.0f - abs(world.y) / pixel.y, 0.0f, 1.0f);
+    float tickX = abs(world.y) <= TickLength ? gridX : 0.0f;
+    float tickY = abs(world.x) <= TickLength ? gridY : 0.0f;
+
+    vec4 color = vec4(0.0f);
+    color = over(color, vec4(GridColor.rgb, GridColor.a * max(gridX, gridY)));
+    color = over(color, vec4(TickColor.rgb, TickColor.a * max(tickX, tickY)));
+    color = over(color, vec4(AxisColor.rgb, AxisColor.a * max(axisX, axisY)));
+
+    fragColor = color;
+}
+)"
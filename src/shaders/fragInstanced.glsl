@@ -0,0 +1,12 @@
+R"(
+#version 330 core
+
+in vec4 curveColor;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = curveColor;
+}
+)"
@@ -0,0 +1,69 @@
+R"(
+#version 330 core
+
+flat in vec2 prevPt;
+flat in vec2 startPt;
+flat in vec2 endPt;
+flat in vec2 nextPt;
+
+out vec4 fragColor;
+
+uniform vec4  LineColor;
+uniform float Width;
+uniform int   Cap;      // StrokeCap, 0 butt, 1 round, 2 square
+
+float segmentDistance(vec2 pos, vec2 a, vec2 b)
+{
+    vec2  ab    = b - a;
+    vec2  ap    = pos - a;
+    float lenSq = dot(ab, ab);
+    float t     = lenSq > 0.0f ? clamp(dot(ap, ab) / lenSq, 0.0f, 1.0f) : 0.0f;
+
+    return length(ap - t * ab);
+}
+
+void main()
+{
+    vec2  pos       = gl_FragCoord.xy;
+    float dist      = segmentDistance(pos, startPt, endPt);
+    float halfWidth = 0.5f * Width;
+    bool  isFirst   = prevPt == startPt;
+    bool  isLast    = nextPt == endPt;
+
+    // A fragment belongs to the closest of the neighbouring segments, a
+    // tie to the later one, so the overlap at a join is only blended once.
+    if (!isFirst && segmentDistance(pos, prevPt, startPt) < dist)
+        discard;
+    if (!isLast && segmentDistance(pos, endPt, nextPt) <= dist)
+        discard;
+
+    // Signed distance to the outline, the joins come out round.
+    float edge = dist - halfWidth;
+
+    // Butt and square caps cut the round ends off square to the segment.
+    if (Cap != 1 && (isFirst || isLast)) {
+        vec2  dir = endPt - startPt;
+        float len = length(dir);
+
+        dir = len > 1e-6f ? dir / len : vec2(1.0f, 0.0f);
+
+        float along  = dot(pos - startPt, dir);
+        float across = abs(dot(pos - startPt, vec2(-dir.y, dir.x)));
+        float extend = Cap == 2 ? halfWidth : 0.0f;
+
+        // Past an end the outline is the box of the cap.
+        if (isFirst && along < 0.0f)
+            edge = max(across - halfWidth, -along - extend);
+        if (isLast && along > len)
+            edge = max(across - halfWidth, along - len - extend);
+    }
+
+    // Pixel wide ramp centered on the outline.
+    float coverage = clamp(0.5f - edge, 0.0f, 1.0f);
+
+    if (coverage <= 0.0f)
+        discard;
+
+    fragColor = vec4(LineColor.rgb, LineColor.a * coverage);
+}
+)"
@@ -0,0 +1,24 @@
+R"(
+#version 330 core
+
+out vec2 texCoord;
+
+uniform mat4 MVP;
+uniform vec2 ControlPoints[4];
+uniform int  Segments;
+
+void main()
+{
+    float t = float(gl_VertexID) / float(Segments);
+
+    // Same de Casteljau steps as evalBezierN on the CPU.
+    vec2 a = mix(ControlPoints[0], ControlPoints[1], t);
+    vec2 b = mix(ControlPoints[1], ControlPoints[2], t);
+    vec2 c = mix(ControlPoints[2], ControlPoints[3], t);
+    vec2 d = mix(a, b, t);
+    vec2 e = mix(b, c, t);
+
+    texCoord    = vec2(t, 0.0f);
+    gl_Position = MVP * vec4(mix(d, e, t), 0.0f, 1.0f);
+}
+)"
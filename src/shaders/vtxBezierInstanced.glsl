@@ -0,0 +1,53 @@
+R"(
+#version 330 core
+
+layout (location = 0) in vec2  ControlPoint0;
+layout (location = 1) in vec2  ControlPoint1;
+layout (location = 2) in vec2  ControlPoint2;
+layout (location = 3) in vec2  ControlPoint3;
+layout (location = 4) in vec4  Color;
+layout (location = 5) in float Width;
+layout (location = 6) in vec4  Weights;
+
+out vec4 curveColor;
+
+uniform mat4 MVP;
+uniform vec2 Viewport;
+uniform int  Segments;
+
+void main()
+{
+    // Two vertices per step along the curve, one on each side.
+    float t    = float(gl_VertexID / 2) / float(Segments);
+    float side = (gl_VertexID % 2 == 0) ? -0.5f : 0.5f;
+
+    // De Casteljau on the homogeneous form, all weights 1 is a plain cubic.
+    vec3 p0 = vec3(ControlPoint0 * Weights.x, Weights.x);
+    vec3 p1 = vec3(ControlPoint1 * Weights.y, Weights.y);
+    vec3 p2 = vec3(ControlPoint2 * Weights.z, Weights.z);
+    vec3 p3 = vec3(ControlPoint3 * Weights.w, Weights.w);
+
+    vec3 a = mix(p0, p1, t);
+    vec3 b = mix(p1, p2, t);
+    vec3 c = mix(p2, p3, t);
+    vec3 d = mix(a, b, t);
+    vec3 e = mix(b, c, t);
+    vec3 h = mix(d, e, t);
+
+    // The derivative of h.xy / h.z points along h.z (e - d).xy - h.xy (e - d).z.
+    vec2 dir     = h.z * (e.xy - d.xy) - h.xy * (e.z - d.z);
+    vec4 pos     = MVP * vec4(h.xy / h.z, 0.0f, 1.0f);
+    vec2 tangent = (MVP * vec4(dir, 0.0f, 0.0f)).xy * Viewport;
+
+    if (dot(tangent, tangent) < 1e-12f)
+        tangent = (MVP * vec4(ControlPoint3 - ControlPoint0, 0.0f, 0.0f)).xy * Viewport;
+
+    vec2 normal = normalize(vec2(-tangent.y, tangent.x));
+
+    // Width is in pixels, convert the offset to clip space.
+    pos.xy += normal * side * Width * 2.0f / Viewport * pos.w;
+
+    curveColor  = Color;
+    gl_Position = pos;
+}
+)"
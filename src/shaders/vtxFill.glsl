@@ -0,0 +1,16 @@
+R"(
+#version 330 core
+
+layout (location = 0) in vec2 Vertex;
+layout (location = 1) in vec3 Klm;
+
+out vec3 klm;
+
+uniform mat4 MVP;
+
+void main()
+{
+    klm         = Klm;
+    gl_Position = MVP * vec4(Vertex, 0.0f, 1.0f);
+}
+)"
@@ -0,0 +1,12 @@
+R"(
+#version 330 core
+
+void main()
+{
+    // One clockwise triangle that covers the whole screen.
+    vec2 pos = vec2(gl_VertexID == 2 ? 3.0f : -1.0f,
+                    gl_VertexID == 1 ? 3.0f : -1.0f);
+
+    gl_Position = vec4(pos, 0.0f, 1.0f);
+}
+)"
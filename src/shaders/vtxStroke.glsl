@@ -0,0 +1,48 @@
+R"(
+#version 330 core
+
+// One instance per polyline segment, Start to End, with its neighbours.
+// The first and last segment repeat their end point as the neighbour.
+layout (location = 0) in vec2 Prev;
+layout (location = 1) in vec2 Start;
+layout (location = 2) in vec2 End;
+layout (location = 3) in vec2 Next;
+
+flat out vec2 prevPt;
+flat out vec2 startPt;
+flat out vec2 endPt;
+flat out vec2 nextPt;
+
+uniform mat4  MVP;
+uniform vec2  Viewport;
+uniform float Width;
+
+vec2 toWindow(vec2 pos)
+{
+    vec4 clip = MVP * vec4(pos, 0.0f, 1.0f);
+
+    return (clip.xy / clip.w * 0.5f + 0.5f) * Viewport;
+}
+
+void main()
+{
+    prevPt  = toWindow(Prev);
+    startPt = toWindow(Start);
+    endPt   = toWindow(End);
+    nextPt  = toWindow(Next);
+
+    vec2  dir = endPt - startPt;
+    float len = length(dir);
+
+    dir = len > 1e-6f ? dir / len : vec2(1.0f, 0.0f);
+
+    // Half the width and a pixel for the coverage ramp on every side.
+    // The corners are clockwise on screen whichever way the segment runs.
+    float reach  = 0.5f * Width + 1.0f;
+    vec2  normal = vec2(-dir.y, dir.x);
+    vec2  base   = gl_VertexID < 2 ? startPt - reach * dir : endPt + reach * dir;
+    float side   = gl_VertexID % 2 == 0 ? -reach : reach;
+
+    gl_Position = vec4((base + side * normal) / Viewport * 2.0f - 1.0f, 0.0f, 1.0f);
+}
+)"
@@ -1,17 +1,23 @@
 R"(
 #version 330 core
 
-layout (location = 0) in vec2 Vertex;
-layout (location = 1) in vec2 TexCoord;
+// One instance per glyph.
+layout (location = 0) in vec2 Anchor;   // world position the label belongs to
+layout (location = 1) in vec4 Glyph;    // top left and bottom right corner in text space
+layout (location = 2) in vec4 Atlas;    // top left and bottom right texture coordinate
 
 out vec2 texCoord;
 
 uniform mat4 MVP;
-uniform vec4 TextOffset;
+uniform mat4 LineMVP;
 
 void main()
 {
-    texCoord    = TexCoord;
-    gl_Position = (MVP * vec4(Vertex, 0.0f, 1.0f)) + TextOffset;
+    // Strip order: top left, top right, bottom left, bottom right.
+    bvec2 corner = bvec2((gl_VertexID & 1) != 0, (gl_VertexID & 2) != 0);
+    vec2  vertex = vec2(corner.x ? Glyph.z : Glyph.x, corner.y ? Glyph.w : Glyph.y);
+
+    texCoord    = vec2(corner.x ? Atlas.z : Atlas.x, corner.y ? Atlas.w : Atlas.y);
+    gl_Position = (LineMVP * vec4(Anchor, 0.0f, 1.0f)) + (MVP * vec4(vertex, 0.0f, 0.0f));
 }
 )"
@@ -0,0 +1,300 @@
+#ifndef GUARD_INCLUDE_STREAM_BUFFER_H
+#define GUARD_INCLUDE_STREAM_BUFFER_H
+
+#ifdef STREAM_BUFFER_STATIC
+    #define STREAM_BUFFER_DEF static
+#else
+    #define STREAM_BUFFER_DEF extern
+#endif
+
+#include <glad/glad.h>
+
+#include "common.h"
+#include "render_state.h"
+
+#if !defined(STREAM_BUFFER_REGIONS)
+    #define STREAM_BUFFER_REGIONS 4
+#endif
+
+/*
+ * Ring of GPU visible staging memory shared by every dynamic upload.
+ * Data is written straight into the ring and then copied on the GPU to
+ * the buffer that keeps it, so the CPU never writes to a buffer the GPU
+ * may still be reading.
+ *
+ * With GL_ARB_buffer_storage the ring is mapped once (persistent and
+ * coherent) and split into STREAM_BUFFER_REGIONS regions.  A region is
+ * fenced when the head leaves it and the head only waits for that fence
+ * when it comes back around, so the CPU never waits for copies out of
+ * the region it is filling or for the frame just submitted.  Without
+ * buffer storage every write maps the range unsynchronized and the
+ * buffer is orphaned when the ring wraps.
+ *
+ * Only one write can be open at a time.
+ */
+struct StreamBuffer {
+    GLuint vbo;
+    u8    *mapped;          // persistent mapping, nullptr when orphaning
+    u32    size;
+    u32    head;            // next free byte
+    u32    region;          // region of the last byte written
+    u32    touched;         // bit per region written since its fence
+    GLsync fences[STREAM_BUFFER_REGIONS];
+
+    /* Writes larger than a region are staged in client memory instead. */
+    u8    *overflow;
+    u32    overflowSize;
+
+    /* Open write. */
+    u8      *data;
+    u32      offset;
+    u32      reserved;
+    GLuint   dstBuffer;
+    GLintptr dstOffset;
+
+    /* Since the last fenceStreamBuffer. */
+    u32    waits;           // times the CPU had to wait for the GPU
+    u32    orphans;
+};
+
+// The head's region is never waited for, there has to be another one.
+static_assert(STREAM_BUFFER_REGIONS >= 2, "The staging ring needs at least two regions.");
+
+STREAM_BUFFER_DEF StreamBuffer makeStreamBuffer(u32 size);
+STREAM_BUFFER_DEF void         freeStreamBuffer(StreamBuffer *stream);
+
+/*
+ * Reserve bytes to be copied to dstBuffer at dstOffset and return the
+ * memory to write them to.
+ */
+STREAM_BUFFER_DEF void *beginStreamWrite(StreamBuffer *stream, GLuint dstBuffer, GLintptr dstOffset, u32 bytes);
+
+/*
+ * Copy the first bytes of the open write, at most as many as were
+ * reserved, to its destination.  dstBuffer has to be large enough by
+ * now, it may be resized between begin and end.
+ */
+STREAM_BUFFER_DEF void endStreamWrite(StreamBuffer *stream, RenderState *state, u32 bytes);
+
+/*
+ * Fence the regions the head has left and reset waits and orphans.
+ * Call once per frame after the last draw that uses streamed data.
+ */
+STREAM_BUFFER_DEF void fenceStreamBuffer(StreamBuffer *stream);
+
+#endif // GUARD_INCLUDE_STREAM_BUFFER_H
+
+
+#ifdef STREAM_BUFFER_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <SDL_log.h>
+
+#if !defined(STREAM_BUFFER_ALIGN)
+    #define STREAM_BUFFER_ALIGN 16
+#endif
+
+static void waitForRegion(StreamBuffer *stream, u32 region)
+{
+    constexpr GLuint64 TIMEOUT_NS = 1000000000;
+
+    auto fence = stream->fences[region];
+
+    if (fence == nullptr)
+        return;
+
+    auto status = glClientWaitSync(fence, 0, 0);
+
+    if (status == GL_TIMEOUT_EXPIRED) {
+        ++stream->waits;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    stream->fences[region] = nullptr;
+}
+
+/* Fence the regions written since their fence, except first to last. */
+static void fenceRegions(StreamBuffer *stream, u32 first, u32 last)
+{
+    for (u32 region = 0; region < STREAM_BUFFER_REGIONS; ++region) {
+        if ((region >= first && region <= last) || !(stream->touched & (1u << region)))
+            continue;
+
+        if (stream->fences[region] != nullptr)
+            glDeleteSync(stream->fences[region]);
+        stream->fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stream->touched &= ~(1u << region);
+    }
+}
+
+static void *stageInClientMemory(StreamBuffer *stream, u32 bytes)
+{
+    if (bytes > stream->overflowSize) {
+        auto overflow = (u8*) realloc(stream->overflow, bytes);
+
+        if (overflow == nullptr) {
+            SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                            "Not enough memory to stage %u bytes.\n", bytes);
+            exit(EXIT_FAILURE);
+        }
+        stream->overflow     = overflow;
+        stream->overflowSize = bytes;
+    }
+    stream->data = stream->overflow;
+
+    return stream->data;
+}
+
+STREAM_BUFFER_DEF StreamBuffer makeStreamBuffer(u32 size)
+{
+    auto stream = StreamBuffer{};
+
+    size -= size % (STREAM_BUFFER_REGIONS * STREAM_BUFFER_ALIGN);
+    stream.size = size;
+
+    glGenBuffers(1, &stream.vbo);
+    glBindBuffer(GL_COPY_READ_BUFFER, stream.vbo);
+
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        constexpr GLbitfield FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, FLAGS);
+        stream.mapped = (u8*) glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, FLAGS);
+
+        if (stream.mapped == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "Persistent mapping failed, streaming by orphaning.\n");
+            // Storage is immutable now, start over with a new buffer.
+            glDeleteBuffers(1, &stream.vbo);
+            glGenBuffers(1, &stream.vbo);
+            glBindBuffer(GL_COPY_READ_BUFFER, stream.vbo);
+        }
+    }
+
+    if (stream.mapped == nullptr)
+        glBufferData(GL_COPY_READ_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    return stream;
+}
+
+STREAM_BUFFER_DEF void freeStreamBuffer(StreamBuffer *stream)
+{
+    for (auto region = 0; region < STREAM_BUFFER_REGIONS; ++region) {
+        if (stream->fences[region] != nullptr)
+            glDeleteSync(stream->fences[region]);
+    }
+
+    if (stream->mapped != nullptr) {
+        glBindBuffer(GL_COPY_READ_BUFFER, stream->vbo);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &stream->vbo);
+    free(stream->overflow);
+    *stream = StreamBuffer{};
+}
+
+STREAM_BUFFER_DEF void *beginStreamWrite(StreamBuffer *stream, GLuint dstBuffer, GLintptr dstOffset, u32 bytes)
+{
+    auto regionSz = stream->size / STREAM_BUFFER_REGIONS;
+
+    stream->dstBuffer = dstBuffer;
+    stream->dstOffset = dstOffset;
+    stream->reserved  = bytes;
+
+    if (bytes > regionSz)
+        return stageInClientMemory(stream, bytes);
+
+    auto head    = (stream->head + STREAM_BUFFER_ALIGN - 1) & ~u32(STREAM_BUFFER_ALIGN - 1);
+    auto wrapped = head + bytes > stream->size;
+
+    if (wrapped)
+        head = 0;
+
+    stream->offset = head;
+    stream->head   = head + bytes;
+
+    if (stream->mapped == nullptr) {
+        constexpr GLbitfield FLAGS = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, stream->vbo);
+        if (wrapped) {
+            // The driver hands out new storage, the old one lives on until the GPU is done.
+            glBufferData(GL_COPY_READ_BUFFER, stream->size, nullptr, GL_STREAM_DRAW);
+            ++stream->orphans;
+        }
+        stream->data = (u8*) glMapBufferRange(GL_COPY_READ_BUFFER, head, bytes, FLAGS);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        // Empty ranges can't be mapped, nothing is lost.
+        if (stream->data == nullptr) {
+            if (bytes > 0)
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "Mapping %u staging bytes failed, staging in client memory.\n", bytes);
+            return stageInClientMemory(stream, bytes);
+        }
+
+        return stream->data;
+    }
+
+    auto first = head / regionSz;
+    auto last  = bytes > 0 ? (head + bytes - 1) / regionSz : first;
+
+    // The copies out of the regions left behind were issued by now.
+    fenceRegions(stream, first, last);
+
+    for (auto region = first; region <= last; ++region) {
+        if (!(stream->touched & (1u << region)))
+            waitForRegion(stream, region);
+        stream->touched |= 1u << region;
+    }
+    stream->region = last;
+
+    stream->data = stream->mapped + head;
+    return stream->data;
+}
+
+STREAM_BUFFER_DEF void endStreamWrite(StreamBuffer *stream, RenderState *state, u32 bytes)
+{
+    if (bytes > stream->reserved)
+        bytes = stream->reserved;
+
+    state->uploadedBytes += bytes;
+    ++state->issuedCalls;
+
+    if (stream->data == stream->overflow) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, stream->dstBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, stream->dstOffset, bytes, stream->data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        stream->data = nullptr;
+        return;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, stream->vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream->dstBuffer);
+    if (stream->mapped == nullptr)
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    if (bytes > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stream->offset, stream->dstOffset, bytes);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    stream->data = nullptr;
+}
+
+STREAM_BUFFER_DEF void fenceStreamBuffer(StreamBuffer *stream)
+{
+    // The head's region is fenced once the head moves on.
+    fenceRegions(stream, stream->region, stream->region);
+
+    stream->waits   = 0;
+    stream->orphans = 0;
+}
+
+#endif // STREAM_BUFFER_IMPLEMENTATION
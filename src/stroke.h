@@ -0,0 +1,268 @@
+#ifndef GUARD_INCLUDE_STROKE_H
+#define GUARD_INCLUDE_STROKE_H
+
+#ifdef STROKE_STATIC
+    #define STROKE_DEF static
+#else
+    #define STROKE_DEF extern
+#endif
+
+#include "m3d.h"
+#include "common.h"
+
+#if !defined(STROKE_MAX_ARC_STEPS)
+    #define STROKE_MAX_ARC_STEPS 64     // per half turn
+#endif
+
+enum class StrokeJoin : i32 {
+    Miter = 0,      // falls back to Bevel beyond the miter limit
+    Round = 1,
+    Bevel = 2,
+    Count,
+};
+
+enum class StrokeCap : i32 {
+    Butt   = 0,
+    Round  = 1,
+    Square = 2,
+    Count,
+};
+
+struct StrokeStyle {
+    f32        width;
+    StrokeJoin join;
+    StrokeCap  cap;
+    f32        miterLimit;  // longest miter as a multiple of width
+    f32        tolerance;   // how far round joins and caps may be off a true arc
+};
+
+STROKE_DEF StrokeStyle makeStrokeStyle(f32 width, StrokeJoin join, StrokeCap cap);
+
+/*
+ * Most vertices strokePolyline writes for count points in style.
+ */
+STROKE_DEF u32 strokeVertexBound(u32 count, StrokeStyle const &style);
+
+/*
+ * Write the outline of the polyline points as one triangle strip to out,
+ * which needs room for strokeVertexBound vertices, and return the number
+ * of vertices written.  Joins are drawn on the outer side of each turn,
+ * on the inner side the segments overlap, so a translucent stroke is
+ * darker there.  Repeated points are skipped.  A single point (or
+ * repeats of it) gets both caps, a dot or a square.
+ */
+STROKE_DEF u32 strokePolyline(Vec2 const *points, u32 count, StrokeStyle const &style, Vec2 *out);
+
+#endif // GUARD_INCLUDE_STROKE_H
+
+
+#ifdef STROKE_IMPLEMENTATION
+
+#include <math.h>
+
+STROKE_DEF StrokeStyle makeStrokeStyle(f32 width, StrokeJoin join, StrokeCap cap)
+{
+    return StrokeStyle{ width, join, cap, 4.0f, 0.25f };
+}
+
+/*
+ * Steps that keep an arc of angle within tolerance of the circle, every
+ * step's chord is off by at most halfWidth * (1 - cos(step / 2)).
+ */
+static u32 arcSteps(StrokeStyle const &style, f32 angle)
+{
+    auto halfWidth = 0.5f * style.width;
+
+    if (halfWidth <= style.tolerance)
+        return 1;
+
+    auto step  = 2.0f * acosf(1.0f - style.tolerance / halfWidth);
+    auto steps = u32(ceilf(angle / step));
+    auto limit = u32(ceilf(STROKE_MAX_ARC_STEPS * angle / PI));
+
+    if (steps > limit) steps = limit;
+    if (steps < 1)     steps = 1;
+
+    return steps;
+}
+
+STROKE_DEF u32 strokeVertexBound(u32 count, StrokeStyle const &style)
+{
+    auto capSteps = arcSteps(style, 0.5f * PI);
+    auto startCap = u32(2);
+    auto endCap   = u32(2);
+
+    if (style.cap == StrokeCap::Square) {
+        startCap = 4;
+        endCap   = 4;
+    } else if (style.cap == StrokeCap::Round) {
+        startCap = 2 * (capSteps + 1);
+        endCap   = 2 * (capSteps + 1);
+    }
+
+    // Pair before, the outer points around the join and the pair after.
+    auto join = u32(8);
+
+    if (style.join == StrokeJoin::Miter)
+        join += 2;
+    else if (style.join == StrokeJoin::Round)
+        join += 2 * (arcSteps(style, PI) - 1);
+
+    return startCap + endCap + (count > 2 ? count - 2 : 0) * join;
+}
+
+static Vec2 leftNormal(Vec2 dir)
+{
+    return vec2(-dir.y, dir.x);
+}
+
+static Vec2 rotate(Vec2 v, f32 cosA, f32 sinA)
+{
+    return vec2(v.x * cosA - v.y * sinA, v.x * sinA + v.y * cosA);
+}
+
+STROKE_DEF u32 strokePolyline(Vec2 const *points, u32 count, StrokeStyle const &style, Vec2 *out)
+{
+    constexpr f32 SAME_SQ  = 1e-12f;
+    constexpr f32 STRAIGHT = 1e-6f;
+
+    if (count == 0)
+        return 0;
+
+    auto halfWidth = 0.5f * style.width;
+    auto written   = u32(0);
+    auto capSteps  = arcSteps(style, 0.5f * PI);
+
+    // Strip vertices alternate between the left and the right side.
+    auto pair = [&](Vec2 left, Vec2 right) {
+        out[written++] = left;
+        out[written++] = right;
+    };
+
+    auto startCap = [&](Vec2 pt, Vec2 dir) {
+        auto side = halfWidth * leftNormal(dir);
+        auto back = -halfWidth * dir;
+
+        if (style.cap == StrokeCap::Square) {
+            pair(pt + back + side, pt + back - side);
+        } else if (style.cap == StrokeCap::Round) {
+            // Mirrored pairs sweep the half disk from its tip outwards.
+            for (u32 step = 0; step < capSteps; ++step) {
+                auto angle = 0.5f * PI * f32(step) / f32(capSteps);
+                auto along = cosf(angle) * back;
+                auto wide  = sinf(angle) * side;
+
+                pair(pt + along + wide, pt + along - wide);
+            }
+        }
+        pair(pt + side, pt - side);
+    };
+
+    auto endCap = [&](Vec2 pt, Vec2 dir) {
+        auto side  = halfWidth * leftNormal(dir);
+        auto ahead = halfWidth * dir;
+
+        pair(pt + side, pt - side);
+        if (style.cap == StrokeCap::Square) {
+            pair(pt + ahead + side, pt + ahead - side);
+        } else if (style.cap == StrokeCap::Round) {
+            for (auto step = i32(capSteps) - 1; step >= 0; --step) {
+                auto angle = 0.5f * PI * f32(step) / f32(capSteps);
+                auto along = cosf(angle) * ahead;
+                auto wide  = sinf(angle) * side;
+
+                pair(pt + along + wide, pt + along - wide);
+            }
+        }
+    };
+
+    /*
+     * The outer points pair up with the center so each strip triangle is
+     * a wedge of the join, on the left side the outer point comes first.
+     */
+    auto join = [&](Vec2 pt, Vec2 dirIn, Vec2 dirOut) {
+        auto normalIn  = leftNormal(dirIn);
+        auto normalOut = leftNormal(dirOut);
+        auto turn      = dirIn.x * dirOut.y - dirIn.y * dirOut.x;
+
+        pair(pt + halfWidth * normalIn, pt - halfWidth * normalIn);
+
+        if (fabsf(turn) < STRAIGHT && dot(dirIn, dirOut) > 0.0f)
+            return;
+
+        // Turning towards the left normal puts the outside on the right.
+        auto outward = turn > 0.0f ? -1.0f : 1.0f;
+        auto outer   = [&](Vec2 offset) {
+            if (outward > 0.0f) pair(pt + offset, pt);
+            else                pair(pt, pt + offset);
+        };
+
+        outer(outward * halfWidth * normalIn);
+
+        if (style.join == StrokeJoin::Miter) {
+            auto bisector = normalIn + normalOut;
+            auto length   = sqrtf(len_sq(bisector));
+
+            if (length > STRAIGHT) {
+                bisector = bisector / length;
+
+                // The miter is 1 / cos(half the turn) widths long.
+                auto cosHalf = dot(bisector, normalIn);
+
+                if (cosHalf * style.miterLimit >= 1.0f)
+                    outer(outward * halfWidth / cosHalf * bisector);
+            }
+        } else if (style.join == StrokeJoin::Round) {
+            auto angle = acosf(clamp(dot(normalIn, normalOut), -1.0f, 1.0f));
+            auto steps = arcSteps(style, angle);
+            auto delta = angle / f32(steps);
+            auto cosA  = cosf(delta);
+            auto sinA  = turn > 0.0f ? sinf(delta) : -sinf(delta);
+            auto arm   = outward * halfWidth * normalIn;
+
+            for (u32 step = 1; step < steps; ++step) {
+                arm = rotate(arm, cosA, sinA);
+                outer(arm);
+            }
+        }
+
+        outer(outward * halfWidth * normalOut);
+        pair(pt + halfWidth * normalOut, pt - halfWidth * normalOut);
+    };
+
+    auto next = u32(1);
+
+    while (next < count && len_sq(points[next] - points[0]) <= SAME_SQ)
+        ++next;
+
+    if (next == count) {
+        startCap(points[0], vec2(1.0f, 0.0f));
+        endCap(points[0], vec2(1.0f, 0.0f));
+        return written;
+    }
+
+    auto pt    = points[next];
+    auto dirIn = (pt - points[0]) / sqrtf(len_sq(pt - points[0]));
+
+    startCap(points[0], dirIn);
+
+    for (auto idx = next + 1; idx < count; ++idx) {
+        auto diff  = points[idx] - pt;
+        auto lenSq = len_sq(diff);
+
+        if (lenSq <= SAME_SQ)
+            continue;
+
+        auto dirOut = diff / sqrtf(lenSq);
+
+        join(pt, dirIn, dirOut);
+        dirIn = dirOut;
+        pt    = points[idx];
+    }
+
+    endCap(pt, dirIn);
+
+    return written;
+}
+
+#endif // STROKE_IMPLEMENTATION
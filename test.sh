@@ -0,0 +1,20 @@
+#!/bin/sh
+# Builds and runs the headless fill test on Linux.  Needs the SDL2
+# development package (for sdl2-config) and Mesa's EGL.
+set -e
+
+PROJDIR=$(pwd)
+SRC=$PROJDIR/src
+VENDOR=$PROJDIR/vendor
+
+INCLUDES="$(sdl2-config --cflags) -I$VENDOR/glad/include -I$SRC -I$VENDOR/glad/src"
+IMPORTS="$(sdl2-config --libs) -lEGL -ldl"
+CXXFLAGS="-std=c++14 -O2 -fno-rtti -fno-exceptions -fkeep-inline-functions"
+
+mkdir -p build
+cd build
+
+c++ $CXXFLAGS $INCLUDES -c $SRC/bezier_unity.cpp -o bezier_unity.o
+c++ $CXXFLAGS $INCLUDES $SRC/fill_test.cpp bezier_unity.o $IMPORTS -o fill_test
+
+LIBGL_ALWAYS_SOFTWARE=1 ./fill_test